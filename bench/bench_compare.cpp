@@ -0,0 +1,258 @@
+/*
+ * Regression check of a mapping_bench result against a baseline result.
+ *
+ * For every circuit and phase, the difference of the mean times (current - baseline) is estimated with a
+ * confidence interval (Welch's t-interval over the samples of both runs). A phase is flagged as slower if the whole
+ * interval lies above <min-change> of the baseline mean and above <min-seconds>, i.e. if the slowdown is both
+ * statistically significant and relevant. Besides, every increase of the SWAPs, gates or depth of a mapped circuit
+ * is a regression, as is a circuit that can no longer be mapped.
+ *
+ * Exit status: 0 if there is no regression, 1 if there is one, 2 if the results cannot be read.
+ *
+ * Usage: bench_compare [--confidence <level>] [--min-change <fraction>] [--min-seconds <s>] [--verbose]
+ *                      <baseline.json> <current.json>
+ */
+#include <json.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* phases[] = {"parse", "dist", "search", "emit"};
+static const char* quality_metrics[] = {"swaps", "mapped_ngates", "mapped_depth"};
+
+//Continued fraction of the regularized incomplete beta function (modified Lentz's method)
+static double beta_continued_fraction(double a, double b, double x) {
+	const double tiny = 1e-300;
+	double c = 1;
+	double d = 1 - (a + b) * x / (a + 1);
+	d = 1 / (std::fabs(d) < tiny ? tiny : d);
+	double h = d;
+	for (int m = 1; m <= 300; m++) {
+		for (int odd = 0; odd <= 1; odd++) {
+			double num = odd == 0 ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+								  : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+			d = 1 + num * d;
+			d = 1 / (std::fabs(d) < tiny ? tiny : d);
+			c = 1 + num / c;
+			c = std::fabs(c) < tiny ? tiny : c;
+			h *= d * c;
+			if (odd == 1 && std::fabs(d * c - 1) < 1e-12) {
+				return h;
+			}
+		}
+	}
+	return h;
+}
+
+//Regularized incomplete beta function I_x(a, b)
+static double incomplete_beta(double a, double b, double x) {
+	if (x <= 0 || x >= 1) {
+		return x <= 0 ? 0 : 1;
+	}
+	double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1 - x));
+	if (x < (a + 1) / (a + b + 2)) {
+		return front * beta_continued_fraction(a, b, x) / a;
+	}
+	return 1 - front * beta_continued_fraction(b, a, 1 - x) / b;
+}
+
+//Quantile t such that P(|T| > t) = alpha for Student's t distribution with df degrees of freedom
+static double student_t_quantile(double alpha, double df) {
+	double lo = 0;
+	double hi = 1e6;
+	for (int i = 0; i < 200; i++) {
+		double t = (lo + hi) / 2;
+		double p = incomplete_beta(df / 2, 0.5, df / (df + t * t));
+		if (p > alpha) {
+			lo = t;
+		} else {
+			hi = t;
+		}
+	}
+	return (lo + hi) / 2;
+}
+
+struct samples {
+	size_t n = 0;
+	double mean = 0;
+	double var = 0;
+};
+
+static bool read_samples(const json_value* phase, samples& s) {
+	const json_value* values = phase != NULL ? phase->get("samples") : NULL;
+	if (values == NULL || values->kind != json_value::Kind::array || values->array.empty()) {
+		return false;
+	}
+	s.n = values->array.size();
+	for (const json_value& v : values->array) {
+		s.mean += v.number;
+	}
+	s.mean /= s.n;
+	for (const json_value& v : values->array) {
+		s.var += (v.number - s.mean) * (v.number - s.mean);
+	}
+	s.var = s.n > 1 ? s.var / (s.n - 1) : 0;
+	return true;
+}
+
+static bool read_results(const char* fname, std::map<std::string, json_value>& circuits) {
+	std::ifstream in(fname);
+	if (!in.good()) {
+		std::cerr << "ERROR: cannot open " << fname << std::endl;
+		return false;
+	}
+	std::stringstream ss;
+	ss << in.rdbuf();
+	json_value doc;
+	std::string error;
+	if (!json_parse(ss.str(), doc, error)) {
+		std::cerr << "ERROR in " << fname << ": " << error << std::endl;
+		return false;
+	}
+	const json_value* list = doc.get("circuits");
+	if (list == NULL || list->kind != json_value::Kind::array) {
+		std::cerr << "ERROR in " << fname << ": no circuits" << std::endl;
+		return false;
+	}
+	for (const json_value& c : list->array) {
+		const json_value* name = c.get("name");
+		if (name != NULL) {
+			circuits[name->string] = c;
+		}
+	}
+	return true;
+}
+
+static double number(const json_value& circuit, const char* name) {
+	const json_value* v = circuit.get(name);
+	return v != NULL ? v->number : 0;
+}
+
+int main(int argc, char** argv) {
+	double confidence = 0.99;
+	double min_change = 0.05;
+	double min_seconds = 1e-5;
+	bool verbose = false;
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--confidence") == 0 && i + 1 < argc) {
+			confidence = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--min-change") == 0 && i + 1 < argc) {
+			min_change = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--min-seconds") == 0 && i + 1 < argc) {
+			min_seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--verbose") == 0) {
+			verbose = true;
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.size() != 2 || confidence <= 0 || confidence >= 1) {
+		std::cerr << "Usage: " << argv[0] << " [--confidence <level>] [--min-change <fraction>] [--min-seconds <s>] [--verbose] <baseline.json> <current.json>" << std::endl;
+		return 2;
+	}
+
+	std::map<std::string, json_value> baseline;
+	std::map<std::string, json_value> current;
+	if (!read_results(files[0], baseline) || !read_results(files[1], current)) {
+		return 2;
+	}
+
+	int regressions = 0;
+	int improvements = 0;
+	int compared = 0;
+	for (std::map<std::string, json_value>::const_iterator it = baseline.begin(); it != baseline.end(); it++) {
+		const std::string& name = it->first;
+		const json_value& base = it->second;
+		if (base.get("error") != NULL) {
+			continue;
+		}
+		std::map<std::string, json_value>::const_iterator found = current.find(name);
+		if (found == current.end()) {
+			printf("REGRESSION  %-28s missing in %s\n", name.c_str(), files[1]);
+			regressions++;
+			continue;
+		}
+		const json_value& cur = found->second;
+		if (cur.get("error") != NULL) {
+			printf("REGRESSION  %-28s %s\n", name.c_str(), cur.get("error")->string.c_str());
+			regressions++;
+			continue;
+		}
+		compared++;
+		if (number(base, "ngates") != number(cur, "ngates") || number(base, "depth") != number(cur, "depth")) {
+			printf("WARNING     %-28s the parsed circuit differs (gates %.0f -> %.0f, depth %.0f -> %.0f)\n",
+				   name.c_str(), number(base, "ngates"), number(cur, "ngates"), number(base, "depth"), number(cur, "depth"));
+		}
+
+		//A faster mapping that adds gates is a regression, too
+		for (const char* metric : quality_metrics) {
+			double b = number(base, metric);
+			double c = number(cur, metric);
+			if (c > b) {
+				printf("REGRESSION  %-28s %-14s %12.0f -> %.0f\n", name.c_str(), metric, b, c);
+				regressions++;
+			} else if (c < b) {
+				printf("IMPROVEMENT %-28s %-14s %12.0f -> %.0f\n", name.c_str(), metric, b, c);
+				improvements++;
+			}
+		}
+
+		for (const char* phase : phases) {
+			samples b;
+			samples c;
+			if (!read_samples(base.get(phase), b) || !read_samples(cur.get(phase), c)) {
+				continue;
+			}
+			if (b.n < 2 || c.n < 2) {
+				if (verbose) {
+					printf("SKIPPED     %-28s %-14s too few samples\n", name.c_str(), phase);
+				}
+				continue;
+			}
+			double diff = c.mean - b.mean;
+			double se2 = b.var / b.n + c.var / c.n;
+			double half_width = 0;
+			if (se2 > 0) {
+				//Welch-Satterthwaite degrees of freedom
+				double df = se2 * se2 / ((b.var / b.n) * (b.var / b.n) / (b.n - 1) + (c.var / c.n) * (c.var / c.n) / (c.n - 1));
+				half_width = student_t_quantile(1 - confidence, df) * std::sqrt(se2);
+			}
+			double lo = diff - half_width;
+			double hi = diff + half_width;
+			double threshold = std::max(min_change * b.mean, min_seconds);
+			const char* verdict = NULL;
+			if (lo > threshold) {
+				verdict = "REGRESSION ";
+				regressions++;
+			} else if (hi < -threshold) {
+				verdict = "IMPROVEMENT";
+				improvements++;
+			} else if (verbose) {
+				verdict = "UNCHANGED  ";
+			}
+			if (verdict != NULL) {
+				printf("%s %-28s %-14s %12.6f -> %.6f s (%+.1f%%, %.0f%% CI of the difference [%+.6f, %+.6f] s)\n",
+					   verdict, name.c_str(), phase, b.mean, c.mean, b.mean > 0 ? 100 * diff / b.mean : 0.0,
+					   100 * confidence, lo, hi);
+			}
+		}
+	}
+	for (std::map<std::string, json_value>::const_iterator it = current.begin(); it != current.end(); it++) {
+		if (baseline.find(it->first) == baseline.end() && verbose) {
+			printf("NEW         %-28s not in %s\n", it->first.c_str(), files[0]);
+		}
+	}
+
+	printf("%d circuits compared: %d regressions, %d improvements\n", compared, regressions, improvements);
+	return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/*
+ * Expression benchmark of the QASM parser. Two programs are parsed <warmup> times without being measured and then
+ * <repeat> times:
+ *
+ *   gate_body       a gate whose body uses its parameters in nested expressions is applied <calls> times with
+ *                   expressions as arguments, i.e. the body is rewritten and folded for every call
+ *   literal_angles  <calls> U gates with constant expressions as angles at the top level
+ *
+ * The results are written as JSON in the format of mapping_bench (the parse phase only), hence bench_compare guards
+ * them. Only the public API of the parser is used, i.e. the benchmark also builds against the parser before the
+ * expression arena (see ExprArena), which gives the baseline to compare with.
+ *
+ * Usage: expr_bench [--warmup <n>] [--repeat <n>] [--calls <n>] [--output <file.json|->]
+ */
+#include <QASMparser.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define EXPR_BENCH_QUBITS 16
+
+struct program_bench {
+	const char* name;
+	std::string source;
+	unsigned int ngates = 0;
+	std::vector<double> seconds;
+};
+
+//A gate with four parameters, each used several times in nested expressions of its body
+static std::string gate_body_program(unsigned long calls) {
+	std::ostringstream out;
+	out << "OPENQASM 2.0;\nqreg q[" << EXPR_BENCH_QUBITS << "];\n";
+	out << "gate g(a,b,c,d) x,y {\n"
+		<< "  U(a*2+b/3, sin(c)-d^2, -(a+b)*cos(d)) x;\n"
+		<< "  CX x,y;\n"
+		<< "  U(sqrt(a*a+b*b)/(c+1), exp(-d)*pi, ln(c+2)-a/4) y;\n"
+		<< "  U((a-b)*(c-d)/2, tan(a/8)+b^2, pi/2-c*d) x;\n"
+		<< "  CX y,x;\n"
+		<< "  U(-a+b-c+d, (a*b+c*d)/(1+a*a), sin(a)*cos(b)-cos(c)*sin(d)) y;\n"
+		<< "  U(a/2, b/2, (c+d)/2) x;\n"
+		<< "}\n";
+	for (unsigned long i = 0; i < calls; i++) {
+		//distinct arguments for every call, the last one is an expression itself
+		out << "g(" << 0.001 * (i % 997) << ", " << 0.5 + 0.002 * (i % 491) << ", pi/" << 2 + i % 13 << ", "
+			<< 0.25 << "*" << 1 + i % 7 << "-0.1) q[" << i % EXPR_BENCH_QUBITS << "],q["
+			<< (i + 1 + i % (EXPR_BENCH_QUBITS - 1)) % EXPR_BENCH_QUBITS << "];\n";
+	}
+	return out.str();
+}
+
+//U gates with constant expressions, folded at the top level
+static std::string literal_angles_program(unsigned long calls) {
+	std::ostringstream out;
+	out << "OPENQASM 2.0;\nqreg q[" << EXPR_BENCH_QUBITS << "];\n";
+	for (unsigned long i = 0; i < calls; i++) {
+		out << "U(" << 0.001 * (i % 997) << "*2+pi/4, sin(" << 0.002 * (i % 491) << ")-0.5^2, -(" << 1 + i % 13
+			<< "+0.5)*cos(pi/3)) q[" << i % EXPR_BENCH_QUBITS << "];\n";
+	}
+	return out.str();
+}
+
+static bool parse_once(const std::string& fname, program_bench& bench, bool measure) {
+	auto start = std::chrono::steady_clock::now();
+	try {
+		QASMparser parser(fname);
+		parser.Parse();
+		bench.ngates = parser.getNgates();
+	} catch (const std::exception& e) {
+		std::cerr << bench.name << ": " << e.what() << std::endl;
+		return false;
+	}
+	if (measure) {
+		bench.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return bench.ngates > 0;
+}
+
+static void write_phase(std::ostream& out, const char* name, const std::vector<double>& seconds) {
+	std::vector<double> sorted = seconds;
+	std::sort(sorted.begin(), sorted.end());
+	double mean = 0;
+	for (double s : sorted) {
+		mean += s;
+	}
+	mean /= sorted.size();
+	double var = 0;
+	for (double s : sorted) {
+		var += (s - mean) * (s - mean);
+	}
+	var = sorted.size() > 1 ? var / (sorted.size() - 1) : 0;
+
+	out << "\"" << name << "\": {\"min\": " << sorted.front() << ", \"median\": " << sorted[sorted.size() / 2]
+		<< ", \"mean\": " << mean << ", \"stddev\": " << std::sqrt(var) << ", \"samples\": [";
+	for (size_t i = 0; i < seconds.size(); i++) {
+		out << (i > 0 ? ", " : "") << seconds[i];
+	}
+	out << "]}";
+}
+
+int main(int argc, char** argv) {
+	int warmup = 1;
+	int repeat = 10;
+	unsigned long calls = 10000;
+	std::string output = "-";
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			warmup = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+			repeat = std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc) {
+			calls = std::max(strtoul(argv[++i], NULL, 10), 1ul);
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--warmup <n>] [--repeat <n>] [--calls <n>] [--output <file.json|->]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<program_bench> benches(2);
+	benches[0].name = "gate_body";
+	benches[0].source = gate_body_program(calls);
+	benches[1].name = "literal_angles";
+	benches[1].source = literal_angles_program(calls);
+
+	std::ostringstream out;
+	out << "{\"calls\": " << calls << ", \"warmup\": " << warmup << ", \"repeat\": " << repeat << ", \"circuits\": [";
+	//the parser reads files only (before the expression arena), hence each program is written to a file first
+	std::string fname = "expr_bench_" + std::to_string(getpid()) + ".qasm";
+	for (size_t b = 0; b < benches.size(); b++) {
+		program_bench& bench = benches[b];
+		std::ofstream of(fname);
+		of << bench.source;
+		of.close();
+		bool ok = (bool) of;
+		for (int r = 0; ok && r < warmup + repeat; r++) {
+			ok = parse_once(fname, bench, r >= warmup);
+		}
+		out << (b > 0 ? "," : "") << "\n  {\"name\": \"" << bench.name << "\"";
+		if (!ok) {
+			out << ", \"error\": \"cannot be parsed\"}";
+			continue;
+		}
+		out << ", \"ngates\": " << bench.ngates << ", ";
+		write_phase(out, "parse", bench.seconds);
+		out << "}";
+		std::vector<double> sorted = bench.seconds;
+		std::sort(sorted.begin(), sorted.end());
+		double median = sorted[sorted.size() / 2];
+		fprintf(stderr, "%-16s %10.6f s %12.0f calls/s\n", bench.name, median, calls / median);
+	}
+	out << "\n]}\n";
+	remove(fname.c_str());
+
+	if (output == "-") {
+		std::cout << out.str() << std::flush;
+		return 0;
+	}
+	std::ofstream of(output);
+	of << out.str();
+	of.close();
+	if (!of) {
+		std::cerr << "ERROR: cannot write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}
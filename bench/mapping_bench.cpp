@@ -0,0 +1,227 @@
+/*
+ * Mapping benchmark over a corpus of circuits (by default examples/). Every circuit is parsed and mapped
+ * <warmup> times without being measured and then <repeat> times, measuring the phases separately:
+ *
+ *   parse   parsing the QASM file into layers
+ *   dist    creating the architecture, i.e. its distance table (without --dist-cache)
+ *   search  the A* search of all layers
+ *   emit    the remainder of the mapping, i.e. inserting SWAPs and H gates and writing the mapped circuit
+ *
+ * The results (samples and statistics of each phase, SWAPs inserted, search nodes expanded, peak size of the open
+ * list, peak RSS, peak bytes of each data structure (see memory_stats.h), gates and depth before and after mapping)
+ * are written as JSON (see bench_compare). Circuits with more than <max-gates> elementary gates are skipped;
+ * circuits that cannot be mapped, e.g. within the budget of <max-seconds> per mapping, are listed with their error.
+ * Run it in the directory containing qelib1.inc.
+ *
+ * Usage: mapping_bench [--arch <architecture>] [--warmup <n>] [--repeat <n>] [--max-gates <n>] [--max-seconds <s>]
+ *                      [--output <file.json|->] [<qasm_file|directory> ...]
+ */
+#include <qx_mapping.h>
+#include <json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct phase_samples {
+	const char* name;
+	std::vector<double> seconds;
+};
+
+struct circuit_bench {
+	mapping_result result;
+	unsigned long nswaps = 0;
+	unsigned long peak_open_nodes = 0;
+	memory_usage memory;
+	phase_samples phases[4] = {{"parse", {}}, {"dist", {}}, {"search", {}}, {"emit", {}}};
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Parse and map a circuit once. Returns false if it cannot be mapped (within the budgets).
+static bool run_once(const mapping_job& job, const mapping_options& options, circuit_bench& bench, bool measure) {
+	MappingContext context;
+	context.max_nodes = options.max_nodes;
+	mapping_result& result = bench.result;
+
+	auto start = std::chrono::steady_clock::now();
+	if (!parse_circuit(job, context, result.error)) {
+		return false;
+	}
+	double parse = seconds_since(start);
+	result.nqubits = context.nqubits;
+	result.ngates = context.ngates;
+	result.depth = context.layers.size();
+
+	start = std::chrono::steady_clock::now();
+	std::shared_ptr<const Architecture> arch = Architecture::create(options.arch, context.nqubits, NULL, result.error);
+	if (!arch) {
+		return false;
+	}
+	double dist = seconds_since(start);
+
+	std::string qasm;
+	QASMwriter out(&qasm);
+	start = std::chrono::steady_clock::now();
+	if (options.max_seconds > 0) {
+		context.deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(options.max_seconds));
+	}
+	if (!map_circuit(*arch, context, &out, result.error)) {
+		return false;
+	}
+	out.flush();
+	double map = seconds_since(start);
+
+	result.ok = true;
+	result.mapped_ngates = context.mapped_ngates;
+	result.mapped_depth = context.mapped_depth;
+	result.expanded_nodes = context.expanded_nodes;
+	bench.nswaps = context.nswaps;
+	bench.peak_open_nodes = context.peak_open_nodes;
+	if (measure) {
+		bench.phases[0].seconds.push_back(parse);
+		bench.phases[1].seconds.push_back(dist);
+		bench.phases[2].seconds.push_back(context.search_seconds);
+		bench.phases[3].seconds.push_back(map - context.search_seconds);
+	}
+	return true;
+}
+
+static void write_phase(std::ostream& out, const phase_samples& phase) {
+	std::vector<double> sorted = phase.seconds;
+	std::sort(sorted.begin(), sorted.end());
+	double mean = 0;
+	for (double s : sorted) {
+		mean += s;
+	}
+	mean /= sorted.size();
+	double var = 0;
+	for (double s : sorted) {
+		var += (s - mean) * (s - mean);
+	}
+	var = sorted.size() > 1 ? var / (sorted.size() - 1) : 0;
+
+	out << "\"" << phase.name << "\": {\"min\": " << sorted.front() << ", \"median\": " << sorted[sorted.size() / 2]
+		<< ", \"mean\": " << mean << ", \"stddev\": " << std::sqrt(var) << ", \"samples\": [";
+	for (size_t i = 0; i < phase.seconds.size(); i++) {
+		out << (i > 0 ? ", " : "") << phase.seconds[i];
+	}
+	out << "]}";
+}
+
+int main(int argc, char** argv) {
+	mapping_options options;
+	int warmup = 1;
+	int repeat = 5;
+	unsigned long max_gates = 0;
+	std::string output = "-";
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--arch") == 0 && i + 1 < argc) {
+			options.arch = argv[++i];
+		} else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			warmup = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+			repeat = std::max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "--max-gates") == 0 && i + 1 < argc) {
+			max_gates = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--max-seconds") == 0 && i + 1 < argc) {
+			options.max_seconds = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			std::cerr << "Usage: " << argv[0] << " [--arch <architecture>] [--warmup <n>] [--repeat <n>] [--max-gates <n>] [--max-seconds <s>] [--output <file.json|->] [<qasm_file|directory> ...]" << std::endl;
+			return 1;
+		} else {
+			paths.push_back(argv[i]);
+		}
+	}
+	if (paths.empty()) {
+		paths.push_back("examples");
+	}
+
+	std::vector<mapping_job> jobs;
+	for (const std::string& path : paths) {
+		std::string error;
+		if (path.size() > 5 && path.compare(path.size() - 5, 5, ".qasm") == 0) {
+			mapping_job job;
+			job.input = path;
+			jobs.push_back(job);
+		} else if (!list_batch_jobs(path, "", jobs, error)) {
+			std::cerr << "ERROR: " << error << std::endl;
+			return 1;
+		}
+	}
+
+	std::ostringstream out;
+	out << "{\"arch\": " << json_escape(options.arch) << ", \"warmup\": " << warmup << ", \"repeat\": " << repeat
+		<< ", \"circuits\": [";
+	int written = 0;
+	for (const mapping_job& job : jobs) {
+		circuit_bench bench;
+		bench.result.name = job.input.substr(job.input.find_last_of('/') + 1);
+		if (max_gates != 0) {
+			MappingContext context;
+			std::string error;
+			if (parse_circuit(job, context, error) && context.ngates > max_gates) {
+				continue;
+			}
+		}
+
+		memory_reset_peaks();
+		bool ok = true;
+		for (int r = 0; ok && r < warmup + repeat; r++) {
+			bench.result.ok = false;
+			ok = run_once(job, options, bench, r >= warmup);
+		}
+		bench.memory = memory_snapshot();
+
+		const mapping_result& result = bench.result;
+		out << (written++ > 0 ? "," : "") << "\n  {\"name\": " << json_escape(result.name);
+		if (!ok) {
+			std::cerr << result.name << ": " << result.error << std::endl;
+			out << ", \"error\": " << json_escape(result.error) << "}";
+			continue;
+		}
+		out << ", \"nqubits\": " << result.nqubits << ", \"ngates\": " << result.ngates << ", \"depth\": "
+			<< result.depth << ", \"mapped_ngates\": " << result.mapped_ngates << ", \"mapped_depth\": "
+			<< result.mapped_depth << ", \"swaps\": " << bench.nswaps << ", \"nodes_expanded\": " << result.expanded_nodes << ", \"peak_open_nodes\": "
+			<< bench.peak_open_nodes << ", \"peak_rss_kb\": " << bench.memory.peak_rss_kb << ", \"peak_bytes\": {";
+		for (int i = 0; i < (int) memory_category::count; i++) {
+			out << (i > 0 ? ", " : "") << "\"" << memory_category_name((memory_category) i) << "\": " << bench.memory.peak[i];
+		}
+		out << "}";
+		double total = 0;
+		for (const phase_samples& phase : bench.phases) {
+			out << ", ";
+			write_phase(out, phase);
+			std::vector<double> sorted = phase.seconds;
+			std::sort(sorted.begin(), sorted.end());
+			total += sorted[sorted.size() / 2];
+		}
+		out << "}";
+		fprintf(stderr, "%-28s %10.6f s %12lu nodes\n", result.name.c_str(), total, result.expanded_nodes);
+	}
+	out << "\n]}\n";
+
+	QASMwriter writer(output);
+	std::string text = out.str();
+	writer.write(text.data(), text.size());
+	writer.flush();
+	if (!writer.good()) {
+		std::cerr << "ERROR: cannot write " << output << std::endl;
+		return 1;
+	}
+	return 0;
+}
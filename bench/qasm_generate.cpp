@@ -0,0 +1,268 @@
+/*
+ * Generator of synthetic OpenQASM circuits for scaling benchmarks. Every circuit has <layers> layers on n qubits;
+ * a layer has round(<cnot-density> * n / 2) CNOTs on disjoint qubits (i.e. <cnot-density> is the fraction of the
+ * qubits taking part in a CNOT) and a random single-qubit gate on each remaining qubit with probability
+ * <single-density>. The locality of the CNOTs is one of:
+ *
+ *   random    both qubits are chosen uniformly
+ *   nearest   the qubits are neighbours on a line, i.e. q[i] and q[i+1]
+ *   chunked   the qubits are in the same chunk of <chunk-size> consecutive qubits, except for a fraction <cross> of
+ *             the CNOTs, which connect two different chunks
+ *   qft       repeated quantum Fourier transforms (controlled phases as two CNOTs and three u1 gates) until the
+ *             same number of CNOTs is reached; <single-density> does not apply
+ *
+ * The circuits only depend on the arguments: the random numbers are generated by splitmix64, which (unlike the
+ * distributions of <random>) gives the same results on all platforms. With several qubit counts, the circuits are
+ * written to <output-dir> as <locality>_<nnnn>q_<seed>.qasm, ready for mapping_bench (see the bench_scaling target).
+ *
+ * Usage: qasm_generate [--qubits <n>[,<n>...]] [--layers <n>] [--cnot-density <d>] [--single-density <d>]
+ *                      [--locality random|nearest|chunked|qft] [--chunk-size <n>] [--cross <p>] [--seed <n>]
+ *                      [--output <file.qasm|-> | --output-dir <directory>]
+ */
+#include <QASMwriter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct generator_options {
+	unsigned int layers = 100;
+	double cnot_density = 0.5;
+	double single_density = 0.5;
+	std::string locality = "random";
+	unsigned int chunk_size = 8;
+	double cross = 0.1;
+	uint64_t seed = 1;
+};
+
+class splitmix64 {
+public:
+	explicit splitmix64(uint64_t seed) : state_(seed) {
+	}
+
+	uint64_t next() {
+		uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	// uniform in [0, n)
+	unsigned int below(unsigned int n) {
+		return (unsigned int) (next() % n);
+	}
+
+	// uniform in [0, 1)
+	double real() {
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+private:
+	uint64_t state_;
+};
+
+static const char* const single_gates[] = {"h", "x", "s", "t", "tdg"};
+
+static void emit(QASMwriter& out, const char* type, int target, int control = -1) {
+	QASMparser::gate g;
+	g.target = target;
+	g.control = control;
+	strncpy(g.type, type, sizeof(g.type) - 1);
+	g.type[sizeof(g.type) - 1] = '\0';
+	out.gate(g);
+}
+
+static void emit_u1(QASMwriter& out, double lambda, int target) {
+	char type[64];
+	snprintf(type, sizeof(type), "u1(%.17g)", lambda);
+	emit(out, type, target);
+}
+
+//Partner of qubit a of a CNOT according to the locality, -1 if there is none
+static int partner(const generator_options& options, unsigned int nqubits, unsigned int a, splitmix64& rng) {
+	if (options.locality == "nearest") {
+		bool up = rng.below(2) == 0;
+		if (up && a + 1 < nqubits) {
+			return a + 1;
+		}
+		return a > 0 ? a - 1 : -1;
+	}
+	if (options.locality == "chunked") {
+		unsigned int nchunks = (nqubits + options.chunk_size - 1) / options.chunk_size;
+		unsigned int chunk = a / options.chunk_size;
+		if (nchunks > 1 && rng.real() < options.cross) {
+			unsigned int other = rng.below(nchunks - 1);
+			chunk = other >= chunk ? other + 1 : other;
+		}
+		unsigned int begin = chunk * options.chunk_size;
+		unsigned int size = std::min(options.chunk_size, nqubits - begin);
+		return begin + rng.below(size);
+	}
+	return rng.below(nqubits);
+}
+
+//Random layers of CNOTs on disjoint qubits and single-qubit gates
+static void generate_layers(const generator_options& options, unsigned int nqubits, unsigned int ncnots,
+							splitmix64& rng, QASMwriter& out) {
+	std::vector<unsigned int> free_qubits;
+	std::vector<bool> used(nqubits);
+	for (unsigned int layer = 0; layer < options.layers; layer++) {
+		free_qubits.resize(nqubits);
+		for (unsigned int q = 0; q < nqubits; q++) {
+			free_qubits[q] = q;
+			used[q] = false;
+		}
+		//rejection sampling of the partners, hence a dense layer of local CNOTs may end up a little smaller
+		unsigned int placed = 0;
+		for (unsigned int attempt = 0; placed < ncnots && attempt < 16 * nqubits && free_qubits.size() >= 2;
+			 attempt++) {
+			unsigned int i = rng.below(free_qubits.size());
+			unsigned int a = free_qubits[i];
+			int b = partner(options, nqubits, a, rng);
+			if (b < 0 || b == (int) a || used[b]) {
+				continue;
+			}
+			used[a] = used[b] = true;
+			free_qubits[i] = free_qubits.back();
+			free_qubits.pop_back();
+			for (size_t j = 0; j < free_qubits.size(); j++) {
+				if (free_qubits[j] == (unsigned int) b) {
+					free_qubits[j] = free_qubits.back();
+					free_qubits.pop_back();
+					break;
+				}
+			}
+			if (rng.below(2) == 0) {
+				emit(out, "cx", b, a);
+			} else {
+				emit(out, "cx", a, b);
+			}
+			placed++;
+		}
+		for (unsigned int q = 0; q < nqubits; q++) {
+			if (!used[q] && rng.real() < options.single_density) {
+				emit(out, single_gates[rng.below(sizeof(single_gates) / sizeof(single_gates[0]))], q);
+			}
+		}
+	}
+}
+
+//Quantum Fourier transforms until ncnots CNOTs are written
+static void generate_qft(unsigned int nqubits, unsigned long ncnots, QASMwriter& out) {
+	unsigned long written = 0;
+	while (written < ncnots) {
+		for (unsigned int j = 0; j < nqubits && written < ncnots; j++) {
+			emit(out, "h", j);
+			for (unsigned int k = j + 1; k < nqubits && written < ncnots; k++) {
+				//controlled phase of pi/2^(k-j), control k and target j
+				double lambda = M_PI / std::ldexp(1.0, k - j);
+				emit_u1(out, lambda / 2, k);
+				emit(out, "cx", j, k);
+				emit_u1(out, -lambda / 2, j);
+				emit(out, "cx", j, k);
+				emit_u1(out, lambda / 2, j);
+				written += 2;
+			}
+		}
+	}
+}
+
+static bool generate(const generator_options& options, unsigned int nqubits, const std::string& output) {
+	QASMwriter out(output);
+	if (!out.good()) {
+		std::cerr << "ERROR: cannot open " << output << std::endl;
+		return false;
+	}
+	out.header(nqubits);
+	std::ostringstream comment;
+	comment << "// generated by qasm_generate --qubits " << nqubits << " --layers " << options.layers
+			<< " --cnot-density " << options.cnot_density << " --single-density " << options.single_density
+			<< " --locality " << options.locality << " --chunk-size " << options.chunk_size << " --cross "
+			<< options.cross << " --seed " << options.seed << "\n";
+	out.write(comment.str().data(), comment.str().size());
+
+	//circuits of different sizes do not share their random numbers
+	splitmix64 rng(options.seed ^ ((uint64_t) nqubits << 32));
+	unsigned int ncnots = std::min<unsigned int>(std::lround(options.cnot_density * nqubits / 2), nqubits / 2);
+	if (options.locality == "qft") {
+		generate_qft(nqubits, (unsigned long) ncnots * options.layers, out);
+	} else {
+		generate_layers(options, nqubits, ncnots, rng, out);
+	}
+	out.flush();
+	if (!out.good()) {
+		std::cerr << "ERROR: cannot write " << output << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	generator_options options;
+	std::vector<unsigned int> qubits;
+	std::string output;
+	std::string output_dir;
+	bool valid = true;
+	for (int i = 1; i < argc && valid; i++) {
+		if (strcmp(argv[i], "--qubits") == 0 && i + 1 < argc) {
+			std::istringstream list(argv[++i]);
+			std::string n;
+			while (std::getline(list, n, ',')) {
+				qubits.push_back(strtoul(n.c_str(), NULL, 10));
+				valid = valid && qubits.back() >= 2;
+			}
+		} else if (strcmp(argv[i], "--layers") == 0 && i + 1 < argc) {
+			options.layers = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--cnot-density") == 0 && i + 1 < argc) {
+			options.cnot_density = atof(argv[++i]);
+			valid = options.cnot_density >= 0 && options.cnot_density <= 1;
+		} else if (strcmp(argv[i], "--single-density") == 0 && i + 1 < argc) {
+			options.single_density = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--locality") == 0 && i + 1 < argc) {
+			options.locality = argv[++i];
+			valid = options.locality == "random" || options.locality == "nearest" || options.locality == "chunked"
+					|| options.locality == "qft";
+		} else if (strcmp(argv[i], "--chunk-size") == 0 && i + 1 < argc) {
+			options.chunk_size = strtoul(argv[++i], NULL, 10);
+			valid = options.chunk_size >= 2;
+		} else if (strcmp(argv[i], "--cross") == 0 && i + 1 < argc) {
+			options.cross = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (strcmp(argv[i], "--output-dir") == 0 && i + 1 < argc) {
+			output_dir = argv[++i];
+		} else {
+			valid = false;
+		}
+	}
+	if (qubits.empty()) {
+		qubits.push_back(16);
+	}
+	if (!valid || (!output.empty() && !output_dir.empty()) || (qubits.size() > 1 && output_dir.empty())) {
+		std::cerr << "Usage: " << argv[0] << " [--qubits <n>[,<n>...]] [--layers <n>] [--cnot-density <d>] [--single-density <d>] [--locality random|nearest|chunked|qft] [--chunk-size <n>] [--cross <p>] [--seed <n>] [--output <file.qasm|-> | --output-dir <directory>]" << std::endl;
+		std::cerr << "Several qubit counts require --output-dir." << std::endl;
+		return 1;
+	}
+
+	for (unsigned int n : qubits) {
+		std::string fname = output.empty() ? "-" : output;
+		if (!output_dir.empty()) {
+			char name[64];
+			snprintf(name, sizeof(name), "_%04uq_%llu.qasm", n, (unsigned long long) options.seed);
+			fname = output_dir + "/" + options.locality + name;
+		}
+		if (!generate(options, n, fname)) {
+			return 1;
+		}
+	}
+	return 0;
+}
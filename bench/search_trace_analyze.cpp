@@ -0,0 +1,318 @@
+/*
+ * Analysis of a search trace (see --search-trace and src/search_trace.h). For every layer searched:
+ *
+ *   generated   nodes generated (without the root), deduped: those dropped as duplicates of a queued node
+ *   expanded    nodes expanded, reexp: expansions of a permutation that has already been expanded in this layer
+ *   branching   generated / expanded, effective: b such that b + b^2 + ... + b^d = generated for solution depth d
+ *   depth       steps (sets of parallel SWAPs) from the root to the node found, swaps: SWAPs on that path
+ *   h/h*        accuracy of the heuristic on the path found: cost_heur of a node divided by its actual remaining
+ *               cost (cost_fixed + cost_heur of the node found minus its cost_fixed), averaged over the path;
+ *               over: nodes of the path whose heuristic overestimates the remaining cost
+ *
+ * The <top> layers with the most expansions are listed (all with --top 0), followed by the totals and the critical
+ * path, i.e. the path found, of the layer with the most expansions (or of --path <layer>). Layers whose root node
+ * is done, i.e. nothing has been expanded, are trivial; they are only counted.
+ *
+ * Usage: search_trace_analyze [--top <n>] [--path <layer>] <trace>
+ */
+#include <search_trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct traced_node {
+	unsigned int parent;
+	int cost_fixed;
+	int cost_heur;
+	int cost_heur2;
+	bool done;
+	size_t swaps_begin; // SWAPs in path_swaps (only for the layer whose path is printed)
+	size_t swaps_end;
+};
+
+struct layer_stats {
+	unsigned int layer = 0;
+	bool searched = false; // false for a layer without expansions, i.e. its CNOTs were executable right away
+	unsigned long generated = 0;
+	unsigned long deduped = 0;
+	unsigned long expanded = 0;
+	unsigned long reexpanded = 0;
+	bool found = false;
+	unsigned int depth = 0;
+	unsigned long swaps = 0;
+	int final_cost = 0;
+	double heuristic_ratio = 0; // mean of h/h* over the nodes of the path with h* > 0
+	unsigned int ratio_nodes = 0;
+	unsigned int overestimates = 0;
+};
+
+//Layer currently read from the trace
+struct layer_search {
+	layer_stats stats;
+	std::vector<traced_node> nodes; // by id
+	std::unordered_set<uint64_t> expanded_states;
+	std::vector<uint64_t> states;
+	std::vector<edge> path_swaps;
+	unsigned int goal = SEARCH_TRACE_NO_PARENT;
+};
+
+//b such that b + b^2 + ... + b^depth = generated
+static double effective_branching(unsigned long generated, unsigned int depth) {
+	if (depth == 0 || generated == 0) {
+		return 0;
+	}
+	double lo = 0;
+	double hi = std::max<double>(generated, 1);
+	for (int i = 0; i < 100; i++) {
+		double b = (lo + hi) / 2;
+		double sum = 0;
+		double power = 1;
+		for (unsigned int d = 0; d < depth && sum <= generated; d++) {
+			power *= b;
+			sum += power;
+		}
+		if (sum < generated) {
+			lo = b;
+		} else {
+			hi = b;
+		}
+	}
+	return (lo + hi) / 2;
+}
+
+//Path from the root to the node found, root first
+static std::vector<unsigned int> critical_path(const layer_search& search) {
+	std::vector<unsigned int> path;
+	for (unsigned int id = search.goal; id != SEARCH_TRACE_NO_PARENT && id < search.nodes.size();
+		 id = search.nodes[id].parent) {
+		path.push_back(id);
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+static void finish_layer(layer_search& search) {
+	layer_stats& stats = search.stats;
+	if (search.goal == SEARCH_TRACE_NO_PARENT || search.goal >= search.nodes.size()) {
+		return;
+	}
+	stats.found = true;
+	const traced_node& goal = search.nodes[search.goal];
+	stats.final_cost = goal.cost_fixed + goal.cost_heur;
+	std::vector<unsigned int> path = critical_path(search);
+	stats.depth = path.size() - 1;
+	for (unsigned int id : path) {
+		const traced_node& n = search.nodes[id];
+		stats.swaps += n.swaps_end - n.swaps_begin;
+		int remaining = stats.final_cost - n.cost_fixed;
+		if (n.cost_heur > remaining) {
+			stats.overestimates++;
+		}
+		if (remaining > 0) {
+			stats.heuristic_ratio += (double) n.cost_heur / remaining;
+			stats.ratio_nodes++;
+		}
+	}
+	if (stats.ratio_nodes > 0) {
+		stats.heuristic_ratio /= stats.ratio_nodes;
+	}
+}
+
+//Read the trace and call visit(search) for every layer; SWAPs are kept for path_layer only
+template<class Visit>
+static bool read_trace(const char* fname, long path_layer, bool warn, Visit visit) {
+	search_trace_reader reader;
+	std::string error;
+	if (!reader.open(fname, error)) {
+		std::cerr << "ERROR: " << error << std::endl;
+		return false;
+	}
+	layer_search search;
+	bool in_layer = false;
+	search_trace_record r;
+	while (reader.next(r, error)) {
+		if (r.kind == 'L') {
+			if (in_layer) {
+				finish_layer(search);
+				visit(search);
+			}
+			search = layer_search();
+			search.stats.layer = r.layer;
+			in_layer = true;
+		} else if (!in_layer) {
+			error = "record outside of a layer";
+			break;
+		} else if (r.kind == 'N') {
+			if (r.id >= search.nodes.size()) {
+				search.nodes.resize(r.id + 1);
+				search.states.resize(r.id + 1);
+			}
+			traced_node& n = search.nodes[r.id];
+			n.parent = r.parent;
+			n.cost_fixed = r.cost_fixed;
+			n.cost_heur = r.cost_heur;
+			n.cost_heur2 = r.cost_heur2;
+			n.done = r.done;
+			n.swaps_begin = n.swaps_end = search.path_swaps.size();
+			if ((long) r.layer == path_layer) {
+				search.path_swaps.insert(search.path_swaps.end(), r.swaps.begin(), r.swaps.end());
+				n.swaps_end = search.path_swaps.size();
+			} else {
+				//only the number of SWAPs is needed
+				n.swaps_end += r.swaps.size();
+			}
+			search.states[r.id] = r.state;
+			if (r.parent != SEARCH_TRACE_NO_PARENT) {
+				search.stats.generated++;
+				if (!r.inserted) {
+					search.stats.deduped++;
+				}
+			}
+		} else if (r.kind == 'E') {
+			search.stats.searched = true;
+			search.stats.expanded++;
+			if (r.id < search.states.size() && !search.expanded_states.insert(search.states[r.id]).second) {
+				search.stats.reexpanded++;
+			}
+		} else if (r.kind == 'G') {
+			search.goal = r.id;
+		}
+	}
+	if (in_layer) {
+		finish_layer(search);
+		visit(search);
+	}
+	if (!error.empty() && in_layer) {
+		//e.g. the mapping has been killed while the trace was written
+		if (warn) {
+			std::cerr << "Warning: " << fname << ": " << error << ", the analysis ends there" << std::endl;
+		}
+	} else if (!error.empty()) {
+		std::cerr << "ERROR in " << fname << ": " << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void print_layer(const layer_stats& s) {
+	printf("%7u %10lu %6.1f%% %10lu %6.1f%% %9.2f %9.2f", s.layer, s.generated,
+		   s.generated > 0 ? 100.0 * s.deduped / s.generated : 0.0, s.expanded,
+		   s.expanded > 0 ? 100.0 * s.reexpanded / s.expanded : 0.0, s.expanded > 0 ? (double) s.generated / s.expanded : 0.0,
+		   effective_branching(s.generated, s.depth));
+	if (s.found) {
+		printf(" %6u %6lu %6d %6.2f %5u\n", s.depth, s.swaps, s.final_cost, s.heuristic_ratio, s.overestimates);
+	} else {
+		printf("  (aborted)\n");
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned long top = 10;
+	long path_layer = -1;
+	const char* fname = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+			top = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+			path_layer = atol(argv[++i]);
+		} else if (fname == NULL && argv[i][0] != '-') {
+			fname = argv[i];
+		} else {
+			fname = NULL;
+			break;
+		}
+	}
+	if (fname == NULL) {
+		std::cerr << "Usage: " << argv[0] << " [--top <n>] [--path <layer>] <trace>" << std::endl;
+		return 1;
+	}
+
+	//First pass: statistics of all layers searched
+	std::vector<layer_stats> layers;
+	unsigned long trivial = 0;
+	if (!read_trace(fname, -1, true, [&layers, &trivial](const layer_search& search) {
+			if (search.stats.searched) {
+				layers.push_back(search.stats);
+			} else {
+				trivial++;
+			}
+		})) {
+		return 1;
+	}
+	if (layers.empty()) {
+		printf("no search in %s (%lu trivial layers)\n", fname, trivial);
+		return 0;
+	}
+
+	layer_stats total;
+	double ratio_sum = 0;
+	unsigned long aborted = 0;
+	for (const layer_stats& s : layers) {
+		total.generated += s.generated;
+		total.deduped += s.deduped;
+		total.expanded += s.expanded;
+		total.reexpanded += s.reexpanded;
+		total.depth += s.depth;
+		total.swaps += s.swaps;
+		total.overestimates += s.overestimates;
+		ratio_sum += s.heuristic_ratio * s.ratio_nodes;
+		total.ratio_nodes += s.ratio_nodes;
+		aborted += s.found ? 0 : 1;
+	}
+	std::vector<layer_stats> sorted = layers;
+	std::stable_sort(sorted.begin(), sorted.end(),
+					 [](const layer_stats& a, const layer_stats& b) { return a.expanded > b.expanded; });
+	if (path_layer < 0) {
+		path_layer = sorted.front().layer;
+	}
+	if (top != 0 && sorted.size() > top) {
+		sorted.resize(top);
+	}
+
+	printf("%7s %10s %7s %10s %7s %9s %9s %6s %6s %6s %6s %5s\n", "layer", "generated", "deduped", "expanded", "reexp",
+		   "branching", "effective", "depth", "swaps", "cost", "h/h*", "over");
+	for (const layer_stats& s : sorted) {
+		print_layer(s);
+	}
+	printf("\n%zu layers searched (%lu aborted, %lu trivial ones not searched): %lu nodes generated (%.1f%% deduped), %lu expanded (%.1f%% re-expansions), "
+		   "branching factor %.2f, %lu SWAPs in %u steps, h/h* %.2f on the paths found, %u overestimates\n",
+		   layers.size(), aborted, trivial, total.generated, total.generated > 0 ? 100.0 * total.deduped / total.generated : 0.0,
+		   total.expanded, total.expanded > 0 ? 100.0 * total.reexpanded / total.expanded : 0.0,
+		   total.expanded > 0 ? (double) total.generated / total.expanded : 0.0, total.swaps, total.depth,
+		   total.ratio_nodes > 0 ? ratio_sum / total.ratio_nodes : 0.0, total.overestimates);
+
+	//Second pass: critical path of one layer
+	bool printed = false;
+	bool ok = read_trace(fname, path_layer, false, [path_layer, &printed](const layer_search& search) {
+		if ((long) search.stats.layer != path_layer || !search.stats.searched || printed) {
+			return;
+		}
+		printed = true;
+		printf("\nCritical path of layer %ld (%lu nodes expanded):\n", path_layer, search.stats.expanded);
+		if (!search.stats.found) {
+			printf("  none, the search has been aborted\n");
+			return;
+		}
+		printf("  %10s %6s %6s %6s %6s  %s\n", "node", "g", "h", "h2", "f", "SWAPs");
+		for (unsigned int id : critical_path(search)) {
+			const traced_node& n = search.nodes[id];
+			printf("  %10u %6d %6d %6d %6d ", id, n.cost_fixed, n.cost_heur, n.cost_heur2,
+				   n.cost_fixed + n.cost_heur + n.cost_heur2);
+			for (size_t i = n.swaps_begin; i < n.swaps_end; i++) {
+				printf(" %d-%d", search.path_swaps[i].v1, search.path_swaps[i].v2);
+			}
+			printf("%s\n", n.done ? " (done)" : "");
+		}
+	});
+	if (ok && !printed) {
+		printf("\nLayer %ld has not been searched\n", path_layer);
+	}
+	return ok ? 0 : 1;
+}
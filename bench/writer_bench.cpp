@@ -0,0 +1,78 @@
+/*
+ * Write throughput of the mapped circuit dump: the former std::ofstream/std::endl loop vs. QASMwriter.
+ *
+ * Usage: writer_bench [<number_of_gates>] [<output_file>]
+ */
+#include <QASMwriter.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static std::vector<QASMparser::gate> make_gates(unsigned long n) {
+	std::vector<QASMparser::gate> gates(n);
+	for (unsigned long i = 0; i < n; i++) {
+		QASMparser::gate& g = gates[i];
+		g.target = i % 16;
+		if (i % 3 == 0) {
+			g.control = (i + 1) % 16;
+			snprintf(g.type, 127, "CX");
+		} else {
+			g.control = -1;
+			snprintf(g.type, 127, "U(%f, %f, %f)", 0.1 * (i % 7), 0.0, 3.141593);
+		}
+	}
+	return gates;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double seconds, unsigned long ngates, const char* fname) {
+	std::ifstream in(fname, std::ifstream::ate | std::ifstream::binary);
+	double mb = in.tellg() / (1024.0 * 1024.0);
+	printf("%-22s %8.3f s %10.1f MB/s %12.0f gates/s\n", name, seconds, mb / seconds, ngates / seconds);
+}
+
+int main(int argc, char** argv) {
+	unsigned long ngates = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+	const char* fname = argc > 2 ? argv[2] : "writer_bench.qasm";
+	std::vector<QASMparser::gate> gates = make_gates(ngates);
+
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::ofstream of(fname);
+		of << "OPENQASM 2.0;" << std::endl;
+		of << "include \"qelib1.inc\";" << std::endl;
+		of << "qreg q[16];" << std::endl;
+		of << "creg c[16];" << std::endl;
+		for (std::vector<QASMparser::gate>::const_iterator it = gates.begin(); it != gates.end(); it++) {
+			of << it->type << " ";
+			if (it->control != -1) {
+				of << "q[" << it->control << "],";
+			}
+			of << "q[" << it->target << "];" << std::endl;
+		}
+		of.close();
+		report("ofstream + endl", seconds_since(start), ngates, fname);
+	}
+
+	{
+		auto start = std::chrono::steady_clock::now();
+		{
+			QASMwriter of(fname);
+			of.header(16);
+			for (std::vector<QASMparser::gate>::const_iterator it = gates.begin(); it != gates.end(); it++) {
+				of.gate(*it);
+			}
+		}
+		report("QASMwriter", seconds_since(start), ngates, fname);
+	}
+
+	remove(fname);
+	return 0;
+}
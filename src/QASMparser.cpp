@@ -24,30 +24,37 @@ by citing the following publication:
 */
 
 #include <QASMparser.h>
+#include <trace.h>
 #include <algorithm>
 #include <cmath>
+#include <list>
+#include <mutex>
 
 QASMparser::QASMparser(std::string filename) {
 	in = new std::ifstream (filename, std::ifstream::in);
 	if(!in->good()) {
-	    std::cerr << "ERROR opening file " << filename << std::endl;
-	    std::exit(1);
+		delete in;
+		throw QASMparseError("cannot open file " + filename);
 	}
+	ownsInput = true;
 	this->scanner = new QASMscanner(*this->in);
 	this->fname = filename;
 	last_layer = new int[1];
 }
 
+QASMparser::QASMparser(std::istream& in_stream) {
+	in = &in_stream;
+	ownsInput = false;
+	this->scanner = new QASMscanner(*this->in);
+	last_layer = new int[1];
+}
+
 QASMparser::~QASMparser() {
 	delete scanner;
-	delete in;
-    delete[] last_layer;
-
-	for(auto it = compoundGates.begin(); it != compoundGates.end(); it++) {
-		for(auto it2 = it->second.gates.begin(); it2 != it->second.gates.end(); it2++) {
-			delete *it2;
-		}
+	if(ownsInput) {
+		delete in;
 	}
+    delete[] last_layer;
 }
 
 void QASMparser::scan() {
@@ -103,25 +110,76 @@ std::pair<std::string, int> QASMparser::QASMargumentCreg() {
 }
 
 
+QASMparser::Expr* QASMparser::ExprArena::allocate() {
+	if(used == blocks.size() * blockSize) {
+		blocks.push_back(std::unique_ptr<Expr[]>(new Expr[blockSize]));
+		charge.add(blockSize * sizeof(Expr));
+	}
+	Expr* expr = &blocks[used / blockSize][used % blockSize];
+	used++;
+	return expr;
+}
+
+QASMparser::Expr* QASMparser::ExprArena::number(double num) {
+	Expr* expr = allocate();
+	expr->kind = Expr::Kind::number;
+	expr->op1 = expr->op2 = NULL;
+	expr->num = num;
+	expr->id.clear();
+	return expr;
+}
+
+QASMparser::Expr* QASMparser::ExprArena::identifier(const std::string& id) {
+	Expr* expr = allocate();
+	expr->kind = Expr::Kind::id;
+	expr->op1 = expr->op2 = NULL;
+	expr->num = 0;
+	expr->id = id;
+	return expr;
+}
+
+QASMparser::Expr* QASMparser::ExprArena::make(Expr::Kind kind, Expr* op1, Expr* op2) {
+	if(op1->kind == Expr::Kind::number && (op2 == NULL || op2->kind == Expr::Kind::number)) {
+		switch(kind) {
+			case Expr::Kind::plus: return number(op1->num + op2->num);
+			case Expr::Kind::minus: return number(op1->num - op2->num);
+			case Expr::Kind::times: return number(op1->num * op2->num);
+			case Expr::Kind::div: return number(op1->num / op2->num);
+			case Expr::Kind::power: return number(pow(op1->num, op2->num));
+			case Expr::Kind::sign: return number(-op1->num);
+			case Expr::Kind::sin: return number(sin(op1->num));
+			case Expr::Kind::cos: return number(cos(op1->num));
+			case Expr::Kind::tan: return number(tan(op1->num));
+			case Expr::Kind::exp: return number(exp(op1->num));
+			case Expr::Kind::ln: return number(log(op1->num));
+			case Expr::Kind::sqrt: return number(sqrt(op1->num));
+			default: break;
+		}
+	}
+	Expr* expr = allocate();
+	expr->kind = kind;
+	expr->op1 = op1;
+	expr->op2 = op2;
+	expr->num = 0;
+	expr->id.clear();
+	return expr;
+}
+
 QASMparser::Expr* QASMparser::QASMexponentiation() {
 	Expr* x;
 
 	if(sym == Token::Kind::real) {
 		scan();
-		return new Expr(Expr::Kind::number, NULL, NULL, t.valReal, "");
-		//return t.val_real;
+		return exprs.number(t.valReal);
 	} else if(sym == Token::Kind::nninteger) {
 		scan();
-		return new Expr(Expr::Kind::number, NULL, NULL, t.val, "");
-		//return t.val;
+		return exprs.number(t.val);
 	} else if(sym == Token::Kind::pi) {
 		scan();
-		return new Expr(Expr::Kind::number, NULL, NULL, 3.141592653589793238463, "");
-		//return 3.141592653589793238463;
+		return exprs.number(3.141592653589793238463);
 	} else if(sym == Token::Kind::identifier) {
 		scan();
-		return new Expr(Expr::Kind::id, NULL, NULL, 0, t.str);
-		//return it->second;
+		return exprs.identifier(t.str);
 	} else if(sym == Token::Kind::lpar) {
 		scan();
 		x = QASMexp();
@@ -133,55 +191,30 @@ QASMparser::Expr* QASMparser::QASMexponentiation() {
 		check(Token::Kind::lpar);
 		x = QASMexp();
 		check(Token::Kind::rpar);
-		if(x->kind == Expr::Kind::number) {
-			if(op == Token::Kind::sin) {
-				x->num = std::sin(x->num);
-			} else if(op == Token::Kind::cos) {
-				x->num = std::cos(x->num);
-			} else if(op == Token::Kind::tan) {
-				x->num = std::tan(x->num);
-			} else if(op == Token::Kind::exp) {
-				x->num = std::exp(x->num);
-			} else if(op == Token::Kind::ln) {
-				x->num = std::log(x->num);
-			} else if(op == Token::Kind::sqrt) {
-				x->num = std::sqrt(x->num);
-			}
-			return x;
-		} else {
-			if(op == Token::Kind::sin) {
-				return new Expr(Expr::Kind::sin, x, NULL, 0, "");
-			} else if(op == Token::Kind::cos) {
-				return new Expr(Expr::Kind::cos, x, NULL, 0, "");
-			} else if(op == Token::Kind::tan) {
-				return new Expr(Expr::Kind::tan, x, NULL, 0, "");
-			} else if(op == Token::Kind::exp) {
-				return new Expr(Expr::Kind::exp, x, NULL, 0, "");
-			} else if(op == Token::Kind::ln) {
-				return new Expr(Expr::Kind::ln, x, NULL, 0, "");
-			} else if(op == Token::Kind::sqrt) {
-				return new Expr(Expr::Kind::sqrt, x, NULL, 0, "");
-			}
+		if(op == Token::Kind::sin) {
+			return exprs.make(Expr::Kind::sin, x);
+		} else if(op == Token::Kind::cos) {
+			return exprs.make(Expr::Kind::cos, x);
+		} else if(op == Token::Kind::tan) {
+			return exprs.make(Expr::Kind::tan, x);
+		} else if(op == Token::Kind::exp) {
+			return exprs.make(Expr::Kind::exp, x);
+		} else if(op == Token::Kind::ln) {
+			return exprs.make(Expr::Kind::ln, x);
+		} else if(op == Token::Kind::sqrt) {
+			return exprs.make(Expr::Kind::sqrt, x);
 		}
 	} else {
 		std::cerr << "Invalid Expression" << std::endl;
 	}
-	return NULL;
+	return exprs.number(0);
 }
 
 QASMparser::Expr* QASMparser::QASMfactor() {
-	Expr* x;
-	Expr* y;
-	x = QASMexponentiation();
+	Expr* x = QASMexponentiation();
 	while (sym == Token::Kind::power) {
 		scan();
-		y = QASMexponentiation();
-		if(x->kind == Expr::Kind::number && y->kind == Expr::Kind::number) {
-			x->num = pow(x->num, y->num);
-			delete y;
-		} else {
-			x = new Expr(Expr::Kind::power, x, y, 0, "");
-		}
+		x = exprs.make(Expr::Kind::power, x, QASMexponentiation());
 	}
 
 	return x;
@@ -189,26 +222,15 @@ QASMparser::Expr* QASMparser::QASMfactor() {
 
 QASMparser::Expr* QASMparser::QASMterm() {
 	Expr* x = QASMfactor();
-	Expr* y;
 
 	while(sym == Token::Kind::times || sym == Token::Kind::div) {
 		Token::Kind op = sym;
 		scan();
-		y = QASMfactor();
+		Expr* y = QASMfactor();
 		if(op == Token::Kind::times) {
-			if(x->kind == Expr::Kind::number && y->kind == Expr::Kind::number) {
-				x->num = x->num * y->num;
-				delete y;
-			} else {
-				x = new Expr(Expr::Kind::times, x, y, 0, "");
-			}
+			x = exprs.make(Expr::Kind::times, x, y);
 		} else {
-			if(x->kind == Expr::Kind::number && y->kind == Expr::Kind::number) {
-				x->num = x->num / y->num;
-				delete y;
-			} else {
-				x = new Expr(Expr::Kind::div, x, y, 0, "");
-			}
+			x = exprs.make(Expr::Kind::div, x, y);
 		}
 	}
 	return x;
@@ -216,15 +238,9 @@ QASMparser::Expr* QASMparser::QASMterm() {
 
 QASMparser::Expr* QASMparser::QASMexp() {
 	Expr* x;
-	Expr* y;
 	if(sym == Token::Kind::minus) {
 		scan();
-		x = QASMterm();
-		if(x->kind == Expr::Kind::number) {
-			x->num = -x->num;
-		} else {
-			x = new Expr(Expr::Kind::sign, x, NULL, 0, "");
-		}
+		x = exprs.make(Expr::Kind::sign, QASMterm());
 	} else {
 		x = QASMterm();
 	}
@@ -232,21 +248,11 @@ QASMparser::Expr* QASMparser::QASMexp() {
 	while(sym == Token::Kind::plus || sym == Token::Kind::minus) {
 		Token::Kind op = sym;
 		scan();
-		y = QASMterm();
+		Expr* y = QASMterm();
 		if(op == Token::Kind::plus) {
-			if(x->kind == Expr::Kind::number && y->kind == Expr::Kind::number) {
-				x->num = x->num + y->num;
-				delete y;
-			} else {
-				x = new Expr(Expr::Kind::plus, x, y, 0, "");
-			}
+			x = exprs.make(Expr::Kind::plus, x, y);
 		} else {
-			if(x->kind == Expr::Kind::number && y->kind == Expr::Kind::number) {
-				x->num = x->num - y->num;
-				delete y;
-			} else {
-				x = new Expr(Expr::Kind::minus, x, y, 0, "");
-			}
+			x = exprs.make(Expr::Kind::minus, x, y);
 		}
 	}
 	return x;
@@ -277,11 +283,12 @@ void QASMparser::addUgate(int target, double theta, double phi, double lambda) {
     g.control = -1;
     snprintf ( g.type, 127, "U(%f, %f, %f)", theta, phi, lambda);
 
-    layer = last_layer[g.target] + 1;
+    //a qubit idle so far may start behind the layers handed over already (see emitLayers())
+    layer = std::max(last_layer[g.target] + 1, (int) emittedLayers);
     last_layer[g.target] = layer;
 
     if (layers.size() <= layer) {
-        layers.push_back(std::vector<gate>());
+        layers.push_back(gate_list());
     }
     layers[layer].push_back(g);
     ngates++;
@@ -295,11 +302,11 @@ void QASMparser::addCXgate(int target, int control) {
     g.control = control;
     snprintf ( g.type, 127, "CX");
 
-    layer = std::max(last_layer[g.target], last_layer[g.control]) + 1;
+    layer = std::max(std::max(last_layer[g.target], last_layer[g.control]) + 1, (int) emittedLayers);
     last_layer[g.target] = last_layer[g.control] = layer;
 
     if (layers.size() <= layer) {
-        layers.push_back(std::vector<gate>());
+        layers.push_back(gate_list());
     }
 
     layers[layer].push_back(g);
@@ -307,6 +314,9 @@ void QASMparser::addCXgate(int target, int control) {
 }
 
 void QASMparser::QASMgate(bool execute) {
+	//the expressions of a gate application are not needed after the gate has been added
+	size_t exprMark = exprs.mark();
+
 	if(sym == Token::Kind::ugate) {
 		scan();
 		check(Token::Kind::lpar);
@@ -324,9 +334,6 @@ void QASMparser::QASMgate(bool execute) {
 			    addUgate(target.first+i, theta->num, phi->num, lambda->num);
 			}
 		}
-		delete theta;
-		delete phi;
-		delete lambda;
 
 #if VERBOSE
 		std::cout << "Applied gate: U" << std::endl;
@@ -397,7 +404,7 @@ void QASMparser::QASMgate(bool execute) {
 				}
 
 				for(auto it = gateIt->second.gates.begin(); it != gateIt->second.gates.end(); it++) {
-					if(Ugate* u = dynamic_cast<Ugate*>(*it)) {
+					if(Ugate* u = dynamic_cast<Ugate*>(it->get())) {
 						Expr* theta = RewriteExpr(u->theta, paramsMap);
 						Expr* phi = RewriteExpr(u->phi, paramsMap);
 						Expr* lambda = RewriteExpr(u->lambda, paramsMap);
@@ -405,10 +412,7 @@ void QASMparser::QASMgate(bool execute) {
 						for(int i = 0; i < argsMap[u->target].second; i++) {
                             addUgate(argsMap[u->target].first+i, theta->num, phi->num, lambda->num);
 						}
-						delete theta;
-						delete phi;
-						delete lambda;
-					} else if(CXgate* cx = dynamic_cast<CXgate*>(*it)) {
+					} else if(CXgate* cx = dynamic_cast<CXgate*>(it->get())) {
 						if(argsMap[cx->control].second == argsMap[cx->target].second) {
 							for(int i = 0; i < argsMap[cx->target].second; i++) {
                                 addCXgate(argsMap[cx->target].first+i, argsMap[cx->control].first+i);
@@ -435,6 +439,8 @@ void QASMparser::QASMgate(bool execute) {
 			std::cerr << "Undefined gate: " << t.str << std::endl;
 		}
 	}
+
+	exprs.release(exprMark);
 }
 
 
@@ -449,84 +455,45 @@ void QASMparser::QASMidList(std::vector<std::string>& identifiers) {
 }
 
 QASMparser::Expr* QASMparser::RewriteExpr(Expr* expr, std::map<std::string, Expr*>& exprMap) {
-	if(expr == NULL) {
-		return NULL;
+	if(expr == NULL || expr->kind == Expr::Kind::number) {
+		return expr;
 	}
+	if(expr->kind == Expr::Kind::id) {
+		auto it = exprMap.find(expr->id);
+		if(it == exprMap.end()) {
+			std::cerr << "Undefined parameter: " << expr->id << std::endl;
+			return exprs.number(0);
+		}
+		return it->second;
+	}
+
 	Expr* op1 = RewriteExpr(expr->op1, exprMap);
 	Expr* op2 = RewriteExpr(expr->op2, exprMap);
+	if(op1 == expr->op1 && op2 == expr->op2) {
+		//nodes are immutable, hence unchanged subtrees are shared
+		return expr;
+	}
+	return exprs.make(expr->kind, op1, op2);
+}
 
-	if(expr->kind == Expr::Kind::number) {
-		return new Expr(expr->kind, op1, op2, expr->num, expr->id);
-	} else if(expr->kind == Expr::Kind::plus) {
-		if(op1->kind == Expr::Kind::number && op2->kind == Expr::Kind::number) {
-			op1->num = op1->num + op2->num;
-			delete op2;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::minus) {
-		if(op1->kind == Expr::Kind::number && op2->kind == Expr::Kind::number) {
-			op1->num = op1->num - op2->num;
-			delete op2;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::sign) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = -op1->num;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::times) {
-		if(op1->kind == Expr::Kind::number && op2->kind == Expr::Kind::number) {
-			op1->num = op1->num * op2->num;
-			delete op2;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::div) {
-		if(op1->kind == Expr::Kind::number && op2->kind == Expr::Kind::number) {
-			op1->num = op1->num / op2->num;
-			delete op2;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::power) {
-		if(op1->kind == Expr::Kind::number && op2->kind == Expr::Kind::number) {
-			op1->num = pow(op1->num,op2->num);
-			delete op2;
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::sin) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = sin(op1->num);
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::cos) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = cos(op1->num);
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::tan) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = tan(op1->num);
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::exp) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = exp(op1->num);
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::ln) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = log(op1->num);
-			return op1;
-		}
-	} else if(expr->kind == Expr::Kind::sqrt) {
-		if(op1->kind == Expr::Kind::number) {
-			op1->num = sqrt(op1->num);
-			return op1;
+void QASMparser::declareGate(const std::string& name, const CompoundGate& gate, bool ownsGates) {
+	compoundGates[name] = gate;
+
+	//Estimate of the memory held by the declaration (map node, strings and the gates of its body)
+	size_t bytes = sizeof(std::pair<const std::string, CompoundGate>) + 4 * sizeof(void*) + name.size();
+	for(const std::string& s : gate.parameterNames) {
+		bytes += sizeof(std::string) + s.size();
+	}
+	for(const std::string& s : gate.argumentNames) {
+		bytes += sizeof(std::string) + s.size();
+	}
+	bytes += gate.gates.size() * sizeof(std::shared_ptr<BasisGate>);
+	if(ownsGates) {
+		for(auto it = gate.gates.begin(); it != gate.gates.end(); it++) {
+			bytes += dynamic_cast<Ugate*>(it->get()) != NULL ? sizeof(Ugate) : sizeof(CXgate);
 		}
-	} else if(expr->kind == Expr::Kind::id) {
-		return new Expr(*exprMap[expr->id]);
 	}
-
-	return new Expr(expr->kind, op1, op2, expr->num, expr->id);
+	gateMemory.add(bytes);
 }
 
 void QASMparser::QASMopaqueGateDecl() {
@@ -544,7 +511,7 @@ void QASMparser::QASMopaqueGateDecl() {
 	}
 	QASMidList(gate.argumentNames);
 
-	compoundGates[gateName] = gate;
+	declareGate(gateName, gate);
 
 	check(Token::Kind::semicolon);
 	//Opaque gate has an empty body
@@ -580,7 +547,7 @@ void QASMparser::QASMgateDecl() {
 			check(Token::Kind::rpar);
 			check(Token::Kind::identifier);
 
-			gate.gates.push_back(new Ugate(theta, phi, lambda, t.str));
+			gate.gates.push_back(std::make_shared<Ugate>(theta, phi, lambda, t.str));
 			check(Token::Kind::semicolon);
 		} else if(sym == Token::Kind::cxgate) {
 			scan();
@@ -588,7 +555,7 @@ void QASMparser::QASMgateDecl() {
 			std::string control = t.str;
 			check(Token::Kind::comma);
 			check(Token::Kind::identifier);
-			gate.gates.push_back(new CXgate(control, t.str));
+			gate.gates.push_back(std::make_shared<CXgate>(control, t.str));
 			check(Token::Kind::semicolon);
 
 		} else if(sym == Token::Kind::identifier) {
@@ -607,7 +574,13 @@ void QASMparser::QASMgateDecl() {
 			QASMidList(arguments);
 			check(Token::Kind::semicolon);
 
-			CompoundGate g = compoundGates[name];
+			auto gIt = compoundGates.find(name);
+			if(gIt == compoundGates.end()) {
+				//the gate may be declared by a file including this one, see QASMdeclarations()
+				undefinedGates = true;
+				continue;
+			}
+			const CompoundGate& g = gIt->second;
 			std::map<std::string, std::string> argsMap;
 			for(unsigned int i = 0; i < arguments.size(); i++) {
 				argsMap[g.argumentNames[i]] = arguments[i];
@@ -619,18 +592,14 @@ void QASMparser::QASMgateDecl() {
 			}
 
 			for(auto it = g.gates.begin(); it != g.gates.end(); it++) {
-				if(Ugate* u = dynamic_cast<Ugate*>(*it)) {
-					gate.gates.push_back(new Ugate(RewriteExpr(u->theta, paramsMap), RewriteExpr(u->phi, paramsMap), RewriteExpr(u->lambda, paramsMap), argsMap[u->target]));
-				} else if(CXgate* cx = dynamic_cast<CXgate*>(*it)) {
-					gate.gates.push_back(new CXgate(argsMap[cx->control], argsMap[cx->target]));
+				if(Ugate* u = dynamic_cast<Ugate*>(it->get())) {
+					gate.gates.push_back(std::make_shared<Ugate>(RewriteExpr(u->theta, paramsMap), RewriteExpr(u->phi, paramsMap), RewriteExpr(u->lambda, paramsMap), argsMap[u->target]));
+				} else if(CXgate* cx = dynamic_cast<CXgate*>(it->get())) {
+					gate.gates.push_back(std::make_shared<CXgate>(argsMap[cx->control], argsMap[cx->target]));
 				} else {
 					std::cerr << "Unexpected gate!" << std::endl;
 				}
 			}
-
-			for(auto it = parameters.begin(); it != parameters.end(); it++) {
-				delete *it;
-			}
 		} else if(sym == Token::Kind::barrier) {
 			scan();
 			std::vector<std::string> arguments;
@@ -645,7 +614,7 @@ void QASMparser::QASMgateDecl() {
 #if VERBOSE & 0
 	std::cout << "Declared gate \"" << gateName << "\":" << std::endl;
 	for(auto it = gate.gates.begin(); it != gate.gates.end(); it++) {
-		if(Ugate* u = dynamic_cast<Ugate*>(*it)) {
+		if(Ugate* u = dynamic_cast<Ugate*>(it->get())) {
 			std::cout << "  U(";
 			printExpr(u->theta);
 			std::cout << ", ";
@@ -653,7 +622,7 @@ void QASMparser::QASMgateDecl() {
 			std::cout << ", ";
 			printExpr(u->lambda);
 			std::cout << ") "<< u->target << ";" << std::endl;
-		} else if(CXgate* cx = dynamic_cast<CXgate*>(*it)) {
+		} else if(CXgate* cx = dynamic_cast<CXgate*>(it->get())) {
 			std::cout << "  CX " << cx->control << ", " << cx->target << ";" << std::endl;
 		} else {
 			std::cout << "other gate" << std::endl;
@@ -661,7 +630,7 @@ void QASMparser::QASMgateDecl() {
 	}
 #endif
 
-	compoundGates[gateName] = gate;
+	declareGate(gateName, gate);
 
 	check(Token::Kind::rbrace);
 }
@@ -767,7 +736,95 @@ void QASMparser::QASMqop(bool execute) {
 	}
 }
 
+void QASMparser::emitLayers(bool all) {
+	if(layerQueue == NULL) {
+		return;
+	}
+	//A new gate is always added behind the last layer of its qubits, hence layers up to the minimum over the qubits
+	//with gates are complete. Qubits without gates do not hold back any layer: their first gate is added behind the
+	//layers handed over (see addUgate() and addCXgate()).
+	unsigned int complete = layers.size();
+	if(!all) {
+		for(unsigned int i = 0; i < nqubits && complete > 0; i++) {
+			if(last_layer[i] != -1) {
+				complete = std::min(complete, (unsigned int)(last_layer[i] + 1));
+			}
+		}
+	}
+	for(; emittedLayers < complete; emittedLayers++) {
+		layerQueue->push(std::move(layers[emittedLayers]));
+		layers[emittedLayers] = gate_list();
+	}
+}
+
+bool QASMparser::QASMdeclarations() {
+	scan();
+	while(sym != Token::Kind::eof) {
+		if(sym == Token::Kind::gate) {
+			QASMgateDecl();
+		} else if(sym == Token::Kind::opaque) {
+			QASMopaqueGateDecl();
+		} else {
+			return false;
+		}
+	}
+	return !undefinedGates;
+}
+
+std::shared_ptr<const QASMparser::Prelude> QASMparser::loadPrelude(const std::string& content) {
+	static std::mutex mutex;
+	//most recently used first, at most PRELUDE_CACHE_ENTRIES (a long running server sees edited include files)
+	static std::list<std::pair<std::string, std::shared_ptr<const Prelude> > > cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for(auto it = cache.begin(); it != cache.end(); it++) {
+		if(it->first == content) {
+			cache.splice(cache.begin(), cache, it);
+			return it->second;
+		}
+	}
+
+	//Only files consisting of self-contained gate declarations can be shared, everything else is read as usual
+	std::istringstream ss(content);
+	QASMparser parser(ss);
+	std::shared_ptr<Prelude> prelude;
+	if(parser.QASMdeclarations()) {
+		prelude = std::make_shared<Prelude>();
+		prelude->exprs = std::move(parser.exprs);
+		prelude->compoundGates = std::move(parser.compoundGates);
+		prelude->gateMemory = std::move(parser.gateMemory);
+		//files rejected as preludes are not kept, they are parsed as usual anyway
+		cache.emplace_front(content, prelude);
+		if(cache.size() > PRELUDE_CACHE_ENTRIES) {
+			cache.pop_back();
+		}
+	}
+	return prelude;
+}
+
+bool QASMparser::includePrelude(const std::string& fname) {
+	TRACE_SCOPE("include", "file", fname);
+	std::ifstream file(fname, std::ifstream::in | std::ifstream::binary);
+	if(!file.good()) {
+		return false;
+	}
+	std::stringstream content;
+	content << file.rdbuf();
+
+	std::shared_ptr<const Prelude> prelude = loadPrelude(content.str());
+	if(!prelude) {
+		return false;
+	}
+	for(auto it = prelude->compoundGates.begin(); it != prelude->compoundGates.end(); it++) {
+		//the gates of the bodies are shared with the prelude
+		declareGate(it->first, it->second, false);
+	}
+	preludes.push_back(prelude);
+	return true;
+}
+
 void QASMparser::Parse() {
+	TRACE_SCOPE("parse");
 
 	scan();
 	check(Token::Kind::openqasm);
@@ -787,6 +844,10 @@ void QASMparser::Parse() {
 			check(Token::Kind::semicolon);
 			//check whether it already exists
 
+			if(emittedLayers > 0) {
+				throw QASMparseError("qreg " + s + " is declared after the first layer has been handed over");
+			}
+
 			qregs[s] = std::make_pair(nqubits, n);
 
 			int* last_layer_new = new int[nqubits + n];
@@ -819,13 +880,17 @@ void QASMparser::Parse() {
 
 		} else if(sym == Token::Kind::ugate || sym == Token::Kind::cxgate || sym == Token::Kind::identifier || sym == Token::Kind::measure || sym == Token::Kind::reset) {
 			QASMqop();
+			emitLayers(false);
 		} else if(sym == Token::Kind::gate) {
 			QASMgateDecl();
 		} else if(sym == Token::Kind::include) {
 			scan();
 			check(Token::Kind::string);
 			std::string fname = t.str;
-			scanner->addFileInput(fname);
+			includes.push_back(fname);
+			if(!includePrelude(fname)) {
+				scanner->addFileInput(fname);
+			}
 			check(Token::Kind::semicolon);
 		} else if(sym == Token::Kind::barrier) {
 			scan();
@@ -854,11 +919,13 @@ void QASMparser::Parse() {
 					creg_num = (creg_num << 1) | (it->second.second[i] & 1);
 				}
 				QASMqop(creg_num == n);
+				emitLayers(false);
 			}
 
 		} else {
-            std::cerr << "ERROR: unexpected statement: started with " << Token::KindNames[sym] << "!" << std::endl;
-            exit(1);
+            throw QASMparseError(std::string("unexpected statement: started with ") + Token::KindNames[sym]);
 		}
 	} while (sym != Token::Kind::eof);
+
+	emitLayers(true);
 }
@@ -28,12 +28,28 @@ by citing the following publication:
 
 #include <QASMscanner.hpp>
 #include <QASMtoken.hpp>
+#include <bounded_queue.h>
+#include <memory_stats.h>
 #include <vector>
 #include <set>
+#include <memory>
+#include <stdexcept>
+
+#define PRELUDE_CACHE_ENTRIES 8 // include files whose parsed gate declarations are kept (see Prelude)
+
+/**
+ * Thrown by QASMparser on errors that make it impossible to continue parsing.
+ */
+class QASMparseError : public std::runtime_error {
+public:
+	explicit QASMparseError(const std::string& what) : std::runtime_error(what) {
+	}
+};
 
 class QASMparser {
 public:
 	QASMparser(std::string fname);
+	QASMparser(std::istream& in_stream);
 	virtual ~QASMparser();
 
 	void Parse();
@@ -44,10 +60,32 @@ public:
         char type[128];
     };
 
-    std::vector<std::vector<gate> > getLayers() {
+    // gates of a layer, charged to memory_category::layers
+    typedef std::vector<gate, counting_allocator<gate, memory_category::layers> > gate_list;
+
+    std::vector<gate_list> getLayers() {
         return layers;
     }
 
+    /**
+     * Transfer the layers to the caller without copying them. The parser holds no layers afterwards.
+     */
+    std::vector<gate_list> takeLayers() {
+        std::vector<gate_list> result;
+        result.swap(layers);
+        return result;
+    }
+
+    /**
+     * Hand each layer to the given queue as soon as no further gate can be added to it, i.e. while Parse() is
+     * still running. The queue is not closed by the parser. Layers handed over are no longer held by the parser.
+     * The first gate of a qubit without gates so far is added behind the layers handed over, i.e. the layering
+     * can differ from the one without a queue.
+     */
+    void setLayerQueue(bounded_queue<gate_list>* queue) {
+        layerQueue = queue;
+    }
+
     int getNqubits() {
         return nqubits;
     }
@@ -56,44 +94,51 @@ public:
         return ngates;
     }
 
+    /**
+     * Names of the files included by the circuit so far (in the order of their include statements).
+     */
+    const std::vector<std::string>& getIncludes() const {
+        return includes;
+    }
+
 private:
 	class Expr {
 	public:
 		enum class Kind {number, plus, minus, sign, times, sin, cos, tan, exp, ln, sqrt, div, power, id};
-		double num;
-		Kind kind;
+		double num = 0;
+		Kind kind = Kind::number;
 		Expr* op1 = NULL;
 		Expr* op2 = NULL;
 		std::string id;
+	};
 
-		Expr(Kind kind,  Expr* op1, Expr* op2, double num, std::string id) {
-			this->kind = kind;
-			this->op1 = op1;
-			this->op2 = op2;
-			this->num = num;
-			this->id = id;
-		}
+	/**
+	 * Bump allocator for the expression nodes of one parse. Nodes are immutable once created and are
+	 * never freed individually, so subtrees can be shared instead of deep-copied. Operations on
+	 * numbers are folded when the node is created, i.e. a literal angle like pi/2 is a single node.
+	 * Nodes of a statement that are no longer needed are recycled via mark() and release().
+	 */
+	class ExprArena {
+	public:
+		Expr* number(double num);
+		Expr* identifier(const std::string& id);
+		Expr* make(Expr::Kind kind, Expr* op1, Expr* op2 = NULL);
 
-		Expr(const Expr& expr) {
-			this->kind = expr.kind;
-			this->num = expr.num;
-			this->id = expr.id;
-			if(expr.op1 != NULL) {
-				this->op1 = new Expr(*expr.op1);
-			}
-			if(expr.op2 != NULL) {
-				this->op2 = new Expr(*expr.op2);
-			}
+		size_t mark() const {
+			return used;
 		}
 
-		~Expr() {
-			if(op1 != NULL) {
-				delete op1;
-			}
-			if(op2 != NULL) {
-				delete op2;
-			}
+		void release(size_t mark) {
+			used = mark;
 		}
+
+	private:
+		static const size_t blockSize = 256;
+		std::vector<std::unique_ptr<Expr[]> > blocks;
+		size_t used = 0;
+		memory_charge charge{memory_category::expressions}; // blocks allocated (without strings of identifiers)
+
+		Expr* allocate();
 	};
 
 	class BasisGate {
@@ -114,18 +159,6 @@ private:
 			this->lambda = lambda;
 			this->target = target;
 		}
-
-		~Ugate() {
-			if(theta != NULL) {
-				delete theta;
-			}
-			if(phi != NULL) {
-				delete phi;
-			}
-			if(lambda != NULL) {
-				delete lambda;
-			}
-		}
 	};
 
 	class CXgate : public BasisGate {
@@ -143,10 +176,22 @@ private:
 	public:
 		std::vector<std::string> parameterNames;
 		std::vector<std::string> argumentNames;
-		std::vector<BasisGate*> gates;
+		std::vector<std::shared_ptr<BasisGate> > gates;
 		bool opaque;
 	};
 
+	/**
+	 * Gate declarations of an include file (e.g. qelib1.inc) together with the arena holding their expressions.
+	 * Preludes are parsed once per process and shared by all parsers including the same file content. The
+	 * PRELUDE_CACHE_ENTRIES most recently included ones are kept while no parser uses them.
+	 */
+	class Prelude {
+	public:
+		ExprArena exprs;
+		std::map<std::string, CompoundGate> compoundGates;
+		memory_charge gateMemory{memory_category::compound_gates};
+	};
+
 	class Snapshot {
 	public:
 		~Snapshot() {
@@ -172,6 +217,7 @@ private:
 
 	std::string fname;
   	std::istream* in;
+	bool ownsInput;
 	QASMscanner* scanner;
 	std::map<std::string, std::pair<int ,int> > qregs;
 	std::map<std::string, std::pair<int, int*> > cregs;
@@ -182,6 +228,9 @@ private:
 	Expr* QASMterm();
 	Expr* QASMexp();
 	void QASMgateDecl();
+	bool QASMdeclarations();
+	bool includePrelude(const std::string& fname);
+	static std::shared_ptr<const Prelude> loadPrelude(const std::string& content);
 	void QASMopaqueGateDecl();
 	void QASMgate(bool execute = true);
 	void QASMqop(bool execute = true);
@@ -190,11 +239,20 @@ private:
 	void QASMargsList(std::vector<std::pair<int, int> >& arguments);
 	std::set<Token::Kind> unaryops {Token::Kind::sin,Token::Kind::cos,Token::Kind::tan,Token::Kind::exp,Token::Kind::ln,Token::Kind::sqrt};
 
+	ExprArena exprs;
 	std::map<std::string, CompoundGate> compoundGates;
+	memory_charge gateMemory{memory_category::compound_gates}; // estimated size of compoundGates
+	void declareGate(const std::string& name, const CompoundGate& gate, bool ownsGates = true);
+	std::vector<std::shared_ptr<const Prelude> > preludes;
+	std::vector<std::string> includes;
+	bool undefinedGates = false;
 	Expr* RewriteExpr(Expr* expr, std::map<std::string, Expr*>& exprMap);
 	void printExpr(Expr* expr);
 
-	std::vector<std::vector<gate> > layers;
+	std::vector<gate_list> layers;
+	bounded_queue<gate_list>* layerQueue = NULL;
+	unsigned int emittedLayers = 0;
+	void emitLayers(bool all);
 
 	unsigned int nqubits = 0;
     int* last_layer;
@@ -32,6 +32,7 @@ by citing the following publication:
 #include <sstream>
 
 #include <QASMscanner.hpp>
+#include <profile.h>
 
 QASMscanner::QASMscanner(std::istream& in_stream) : in(in_stream) {
         // initialize error handling support
@@ -103,6 +104,7 @@ void QASMscanner::nextCh() {
 }
 
 Token QASMscanner::next() {
+	PROFILE_COUNT(scanner_token);
 	while(iswspace(ch)) {
 		nextCh();
     }
@@ -0,0 +1,81 @@
+#include <QASMwriter.h>
+#include <trace.h>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+QASMwriter::QASMwriter(const std::string& fname) {
+	if (fname == "-") {
+		fd = STDOUT_FILENO;
+		ownsFd = false;
+	} else {
+		fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		ownsFd = true;
+	}
+	if (fd == -1) {
+		failed = true;
+	}
+	buffer = new char[capacity];
+	charge.add(capacity);
+}
+
+QASMwriter::QASMwriter(std::string* sink) : fd(-1), ownsFd(false), sink(sink) {
+	buffer = new char[capacity];
+	charge.add(capacity);
+}
+
+QASMwriter::~QASMwriter() {
+	flush();
+	if (ownsFd && fd != -1) {
+		close(fd);
+	}
+	delete[] buffer;
+}
+
+void QASMwriter::header(int nqubits) {
+	std::string s = "OPENQASM 2.0;\ninclude \"qelib1.inc\";\nqreg q[" + std::to_string(nqubits) + "];\ncreg c["
+					+ std::to_string(nqubits) + "];\n";
+	write(s.data(), s.size());
+}
+
+void QASMwriter::write(const char* s, size_t len) {
+	if (capacity - used < len) {
+		flush();
+	}
+	if (len > capacity) {
+		writeAll(s, len);
+		return;
+	}
+	memcpy(buffer + used, s, len);
+	used += len;
+}
+
+void QASMwriter::flush() {
+	if (used == 0) {
+		return;
+	}
+	TRACE_SCOPE("write output", "bytes", used);
+	writeAll(buffer, used);
+	used = 0;
+}
+
+void QASMwriter::writeAll(const char* s, size_t len) {
+	if (sink != NULL) {
+		sink->append(s, len);
+		charge.set(capacity + sink->capacity());
+		return;
+	}
+	size_t written = 0;
+	while (!failed && written < len) {
+		ssize_t n = ::write(fd, s + written, len - written);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			failed = true;
+			break;
+		}
+		written += n;
+	}
+}
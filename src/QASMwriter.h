@@ -0,0 +1,84 @@
+#ifndef QASM_WRITER_H_
+#define QASM_WRITER_H_
+
+#include <QASMparser.h>
+#include <memory_stats.h>
+#include <cstring>
+#include <string>
+
+/**
+ * Writes a (mapped) circuit in the OpenQASM 2.0 format. Output is collected in a large buffer which is only
+ * handed to the operating system when it is full or on flush(), i.e. there is no flush per line.
+ * The file name "-" denotes the standard output. Alternatively, the output can be appended to a string.
+ */
+class QASMwriter {
+public:
+	QASMwriter(const std::string& fname);
+	QASMwriter(std::string* sink);
+	virtual ~QASMwriter();
+
+	bool good() const {
+		return !failed;
+	}
+
+	void header(int nqubits);
+	void flush();
+
+	void gate(const QASMparser::gate& g) {
+		if (capacity - used < maxGateLength) {
+			flush();
+		}
+		size_t len = strlen(g.type);
+		memcpy(buffer + used, g.type, len);
+		used += len;
+		buffer[used++] = ' ';
+		if (g.control != -1) {
+			qubit(g.control);
+			buffer[used++] = ',';
+		}
+		qubit(g.target);
+		buffer[used++] = ';';
+		buffer[used++] = '\n';
+	}
+
+	void write(const char* s, size_t len);
+
+private:
+	static const size_t capacity = 1 << 20;
+	static const size_t maxGateLength = sizeof(QASMparser::gate::type) + 64;
+
+	int fd;
+	bool ownsFd;
+	std::string* sink = NULL;
+	bool failed = false;
+	char* buffer;
+	size_t used = 0;
+	memory_charge charge{memory_category::output}; // buffer and sink (the latter while it is written)
+
+	void writeAll(const char* s, size_t len);
+
+	void qubit(int q) {
+		buffer[used++] = 'q';
+		buffer[used++] = '[';
+		integer(q);
+		buffer[used++] = ']';
+	}
+
+	void integer(int v) {
+		char digits[12];
+		int n = 0;
+		unsigned int u = v < 0 ? -(unsigned int) v : v;
+		do {
+			digits[n++] = '0' + u % 10;
+			u /= 10;
+		} while (u != 0);
+		if (v < 0) {
+			buffer[used++] = '-';
+		}
+		while (n > 0) {
+			buffer[used++] = digits[--n];
+		}
+	}
+};
+
+#endif /* QASM_WRITER_H_ */
@@ -0,0 +1,255 @@
+#include "architecture.h"
+#include "builtin_devices.h"
+#include "json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+#include <sstream>
+#include <vector>
+
+static void insert_undirected(std::set<edge>& graph, int v1, int v2) {
+	graph.insert(edge{v1, v2});
+	graph.insert(edge{v2, v1});
+}
+
+void build_graph_linear(int qubits, std::set<edge>& graph, int& positions) {
+    graph.clear();
+    positions = qubits;
+
+    for(int i = 0; i < qubits-1; i++) {
+        insert_undirected(graph, i, i+1);
+    }
+}
+
+void build_graph_ring(int qubits, std::set<edge>& graph, int& positions) {
+	build_graph_linear(qubits, graph, positions);
+	if (qubits > 2) {
+		insert_undirected(graph, qubits - 1, 0);
+	}
+}
+
+void build_graph_grid(int rows, int cols, std::set<edge>& graph, int& positions) {
+	graph.clear();
+	positions = rows * cols;
+
+	for (int r = 0; r < rows; r++) {
+		for (int c = 0; c < cols; c++) {
+			if (c + 1 < cols) {
+				insert_undirected(graph, r * cols + c, r * cols + c + 1);
+			}
+			if (r + 1 < rows) {
+				insert_undirected(graph, r * cols + c, (r + 1) * cols + c);
+			}
+		}
+	}
+}
+
+void build_graph_heavy_hex(int rows, int cols, std::set<edge>& graph, int& positions) {
+	graph.clear();
+	positions = rows * cols;
+
+	for (int r = 0; r < rows; r++) {
+		for (int c = 0; c + 1 < cols; c++) {
+			insert_undirected(graph, r * cols + c, r * cols + c + 1);
+		}
+	}
+	//bridge qubits are numbered after the qubits of the rows
+	for (int r = 0; r + 1 < rows; r++) {
+		for (int c = (r % 2 == 0) ? 0 : 2; c < cols; c += 4) {
+			int bridge = positions++;
+			insert_undirected(graph, r * cols + c, bridge);
+			insert_undirected(graph, bridge, (r + 1) * cols + c);
+		}
+	}
+}
+
+void build_graph_QX5(std::set<edge>& graph, int& positions) {
+	//the edges are generated at compile time in set order, so every insertion is at the end
+	graph.clear();
+	positions = qx5_positions;
+	for (const edge& e : qx5_tables.edges) {
+		graph.insert(graph.end(), e);
+	}
+}
+
+bool validate_graph(const std::set<edge>& graph, int positions, std::string& error) {
+	if (positions <= 0) {
+		error = "the architecture has no physical qubits";
+		return false;
+	}
+	std::vector<std::vector<int> > neighbours(positions);
+	for (const edge& e : graph) {
+		if (e.v1 < 0 || e.v2 < 0 || e.v1 >= positions || e.v2 >= positions) {
+			error = "edge " + std::to_string(e.v1) + " - " + std::to_string(e.v2) + " refers to a physical qubit outside of 0.."
+					+ std::to_string(positions - 1);
+			return false;
+		}
+		if (e.v1 == e.v2) {
+			error = "self loop at physical qubit " + std::to_string(e.v1);
+			return false;
+		}
+		neighbours[e.v1].push_back(e.v2);
+		neighbours[e.v2].push_back(e.v1);
+	}
+
+	std::vector<bool> reached(positions, false);
+	std::queue<int> queue;
+	reached[0] = true;
+	queue.push(0);
+	int nreached = 1;
+	while (!queue.empty()) {
+		int v = queue.front();
+		queue.pop();
+		for (int n : neighbours[v]) {
+			if (!reached[n]) {
+				reached[n] = true;
+				nreached++;
+				queue.push(n);
+			}
+		}
+	}
+	if (nreached != positions) {
+		error = "the coupling graph is not connected";
+		return false;
+	}
+	return true;
+}
+
+static bool add_edge(std::set<edge>& graph, int& positions, double v1, double v2, std::string& error) {
+	if (v1 < 0 || v2 < 0 || v1 != (int) v1 || v2 != (int) v2) {
+		error = "invalid edge " + std::to_string(v1) + " - " + std::to_string(v2);
+		return false;
+	}
+	graph.insert(edge{(int) v1, (int) v2});
+	positions = std::max(positions, std::max((int) v1, (int) v2) + 1);
+	return true;
+}
+
+bool load_coupling_map(const std::string& fname, std::set<edge>& graph, int& positions, std::string& error) {
+	std::ifstream in(fname);
+	if (!in.good()) {
+		error = "cannot open coupling map " + fname;
+		return false;
+	}
+	std::stringstream content;
+	content << in.rdbuf();
+
+	graph.clear();
+	positions = 0;
+
+	if (fname.size() >= 5 && fname.compare(fname.size() - 5, 5, ".json") == 0) {
+		json_value doc;
+		if (!json_parse(content.str(), doc, error)) {
+			error = fname + ": " + error;
+			return false;
+		}
+		const json_value* edges = doc.kind == json_value::Kind::array ? &doc : doc.get("coupling_map");
+		if (edges == NULL || edges->kind != json_value::Kind::array) {
+			error = fname + ": expected an array of edges";
+			return false;
+		}
+		for (const json_value& e : edges->array) {
+			if (e.kind != json_value::Kind::array || e.array.size() != 2 || e.array[0].kind != json_value::Kind::number
+				|| e.array[1].kind != json_value::Kind::number) {
+				error = fname + ": an edge has to be a pair of physical qubits";
+				return false;
+			}
+			if (!add_edge(graph, positions, e.array[0].number, e.array[1].number, error)) {
+				error = fname + ": " + error;
+				return false;
+			}
+		}
+	} else {
+		std::string line;
+		int lineno = 0;
+		while (std::getline(content, line)) {
+			lineno++;
+			line = line.substr(0, line.find('#'));
+			std::istringstream ls(line);
+			double v1, v2;
+			if (!(ls >> v1)) {
+				continue;
+			}
+			std::string rest;
+			if (!(ls >> v2) || (ls >> rest)) {
+				error = fname + ":" + std::to_string(lineno) + ": expected \"<control> <target>\"";
+				return false;
+			}
+			if (!add_edge(graph, positions, v1, v2, error)) {
+				error = fname + ":" + std::to_string(lineno) + ": " + error;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//Parse "<a>" or "<a>x<b>" (b is optional iff b is not NULL); returns false if the text is malformed
+static bool parse_size(const std::string& text, int& a, int* b) {
+	char* end;
+	a = strtol(text.c_str(), &end, 10);
+	if (b != NULL) {
+		if (*end != 'x') {
+			return false;
+		}
+		const char* begin = end + 1;
+		*b = strtol(begin, &end, 10);
+		if (end == begin || *b <= 0) {
+			return false;
+		}
+	}
+	return end != text.c_str() && *end == '\0' && a > 0;
+}
+
+bool build_architecture(const std::string& spec, unsigned int nqubits, std::set<edge>& graph, int& positions,
+						std::string& error) {
+	size_t colon = spec.find(':');
+	std::string name = spec.substr(0, colon);
+	std::string args = colon == std::string::npos ? "" : spec.substr(colon + 1);
+
+	int a = nqubits, b;
+	bool valid_args = true;
+	if (name == "linear" || name == "ring") {
+		valid_args = args.empty() || parse_size(args, a, NULL);
+		if (valid_args && name == "linear") {
+			build_graph_linear(a, graph, positions);
+		} else if (valid_args) {
+			build_graph_ring(a, graph, positions);
+		}
+	} else if (name == "grid" || name == "heavyhex") {
+		if (args.empty()) {
+			//sized for the circuit, e.g. for circuits of many different sizes
+			a = std::max(1, (int) std::ceil(std::sqrt((double) nqubits)));
+			b = std::max(1, ((int) nqubits + a - 1) / a);
+		} else {
+			valid_args = parse_size(args, a, &b);
+		}
+		if (valid_args && name == "grid") {
+			build_graph_grid(a, b, graph, positions);
+		} else if (valid_args) {
+			build_graph_heavy_hex(a, b, graph, positions);
+		}
+	} else if (spec == "qx5") {
+		build_graph_QX5(graph, positions);
+	} else if (name == "file") {
+		if (!load_coupling_map(args, graph, positions, error)) {
+			return false;
+		}
+	} else if (!load_coupling_map(spec, graph, positions, error)) {
+		error = "unknown architecture " + spec + " (" + error + ")";
+		return false;
+	}
+
+	if (!valid_args) {
+		error = "invalid size in architecture " + spec;
+		return false;
+	}
+	if (!validate_graph(graph, positions, error)) {
+		error = "invalid architecture " + spec + ": " + error;
+		return false;
+	}
+	return true;
+}
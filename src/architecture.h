@@ -0,0 +1,55 @@
+#include <set>
+#include <string>
+
+#ifndef ARCHITECTURE_H
+#define ARCHITECTURE_H
+
+struct edge {
+	int v1;
+	int v2;
+};
+
+constexpr bool operator<(const edge& lhs, const edge& rhs) {
+	if (lhs.v1 != rhs.v1) {
+		return lhs.v1 < rhs.v1;
+	}
+	return lhs.v2 < rhs.v2;
+}
+
+/**
+ * Build the coupling graph (a CNOT with control v1 and target v2 is possible iff edge{v1, v2} is contained)
+ * selected by spec:
+ *   linear[:n]     n physical qubits in a line (n defaults to the number of logical qubits)
+ *   ring[:n]       n physical qubits in a ring (n defaults to the number of logical qubits)
+ *   grid[:RxC]     R rows of C physical qubits with nearest neighbour coupling (without RxC: the smallest almost
+ *                  square grid of at least as many qubits as the circuit)
+ *   heavyhex[:RxC] R rows of C physical qubits, adjacent rows are connected by bridge qubits every 4 columns
+ *                  (alternately starting at column 0 and 2), as in IBM's heavy-hex devices (without RxC: rows
+ *                  as for grid, plus the bridge qubits)
+ *   qx5            the built-in coupling map of build_graph_QX5()
+ *   file:<path>    a coupling map file, see load_coupling_map(); "file:" may be omitted
+ * Returns false and describes the problem in error if the spec is invalid or the coupling map is not usable.
+ */
+bool build_architecture(const std::string& spec, unsigned int nqubits, std::set<edge>& graph, int& positions,
+						std::string& error);
+
+/**
+ * Load a directed coupling map. Text files contain one edge "<control> <target>" per line ('#' starts a comment),
+ * JSON files (*.json) contain an array of [control, target] pairs, either at top level or as member
+ * "coupling_map". The number of physical qubits is given by the largest index.
+ */
+bool load_coupling_map(const std::string& fname, std::set<edge>& graph, int& positions, std::string& error);
+
+void build_graph_linear(int qubits, std::set<edge>& graph, int& positions);
+void build_graph_ring(int qubits, std::set<edge>& graph, int& positions);
+void build_graph_grid(int rows, int cols, std::set<edge>& graph, int& positions);
+void build_graph_heavy_hex(int rows, int cols, std::set<edge>& graph, int& positions);
+void build_graph_QX5(std::set<edge>& graph, int& positions);
+
+/**
+ * Check that all edges refer to physical qubits 0..positions-1, there are no self loops, and that the
+ * coupling graph is connected (otherwise there are qubits that can never interact).
+ */
+bool validate_graph(const std::set<edge>& graph, int positions, std::string& error);
+
+#endif
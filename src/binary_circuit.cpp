@@ -0,0 +1,186 @@
+#include "binary_circuit.h"
+#include "hash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char binary_circuit_magic[8] = {'Q', 'X', 'M', 'A', 'P', 'B', 'I', 'N'};
+
+static_assert(sizeof(binary_circuit_header) == 48, "unexpected padding in binary_circuit_header");
+static_assert(sizeof(binary_circuit_record) == 12, "unexpected padding in binary_circuit_record");
+
+bool is_binary_circuit(const std::string& fname) {
+	char magic[sizeof(binary_circuit_magic)];
+	std::ifstream in(fname, std::ifstream::in | std::ifstream::binary);
+	return in.read(magic, sizeof(magic)) && memcmp(magic, binary_circuit_magic, sizeof(magic)) == 0;
+}
+
+//Bit pattern of an angle, i.e. -0.0 and 0.0 (printed differently into the type of a gate) are distinct
+static uint64_t angle_bits(double angle) {
+	uint64_t bits;
+	memcpy(&bits, &angle, sizeof(bits));
+	return bits;
+}
+
+bool write_binary_circuit(const std::string& fname, const std::vector<QASMparser::gate_list>& layers,
+						  unsigned int nqubits) {
+	std::vector<uint32_t> sizes;
+	std::vector<binary_circuit_record> records;
+	std::vector<double> angles;
+	std::map<std::tuple<uint64_t, uint64_t, uint64_t>, uint32_t> angle_index;
+
+	for (std::vector<QASMparser::gate_list>::const_iterator it = layers.begin(); it != layers.end(); it++) {
+		sizes.push_back(it->size());
+		for (QASMparser::gate_list::const_iterator it2 = it->begin(); it2 != it->end(); it2++) {
+			binary_circuit_record r;
+			r.target = it2->target;
+			if (it2->control != -1) {
+				r.opcode = BINARY_OP_CX;
+				r.arg = it2->control;
+			} else {
+				//the parser only creates U gates with the angles printed into their type
+				double theta, phi, lambda;
+				if (sscanf(it2->type, "U(%lf, %lf, %lf)", &theta, &phi, &lambda) != 3) {
+					std::cerr << "ERROR: gate " << it2->type << " cannot be stored in a binary circuit" << std::endl;
+					return false;
+				}
+				auto inserted = angle_index.insert(std::make_pair(std::make_tuple(angle_bits(theta), angle_bits(phi), angle_bits(lambda)),
+																  (uint32_t) angle_index.size()));
+				if (inserted.second) {
+					angles.push_back(theta);
+					angles.push_back(phi);
+					angles.push_back(lambda);
+				}
+				r.opcode = BINARY_OP_U;
+				r.arg = inserted.first->second;
+			}
+			records.push_back(r);
+		}
+	}
+
+	binary_circuit_header header;
+	memcpy(header.magic, binary_circuit_magic, sizeof(header.magic));
+	header.version = BINARY_CIRCUIT_VERSION;
+	header.nqubits = nqubits;
+	header.nlayers = sizes.size();
+	header.ngates = records.size();
+	header.nangles = angles.size() / 3;
+	header.checksum = fnv1a(sizes.data(), sizes.size() * sizeof(uint32_t));
+	header.checksum = fnv1a(records.data(), records.size() * sizeof(binary_circuit_record), header.checksum);
+	header.checksum = fnv1a(angles.data(), angles.size() * sizeof(double), header.checksum);
+
+	std::ofstream of(fname, std::ofstream::out | std::ofstream::binary);
+	of.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	of.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(uint32_t));
+	of.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(binary_circuit_record));
+	of.write(reinterpret_cast<const char*>(angles.data()), angles.size() * sizeof(double));
+	of.close();
+	if (!of) {
+		std::cerr << "ERROR writing binary circuit " << fname << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool read_binary_circuit(const std::string& fname, std::vector<QASMparser::gate_list>& layers,
+						 unsigned int& nqubits, unsigned long& ngates) {
+	int fd = open(fname.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd == -1 || fstat(fd, &st) != 0) {
+		std::cerr << "ERROR opening file " << fname << std::endl;
+		if (fd != -1) {
+			close(fd);
+		}
+		return false;
+	}
+	size_t size = st.st_size;
+	void* data = size >= sizeof(binary_circuit_header) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (data == MAP_FAILED) {
+		std::cerr << "ERROR: " << fname << " is not a binary circuit" << std::endl;
+		return false;
+	}
+
+	const char* p = static_cast<const char*>(data);
+	binary_circuit_header header;
+	memcpy(&header, p, sizeof(header));
+	bool counts_valid = header.nlayers < size && header.ngates < size && header.nangles < size;
+	size_t payload = header.nlayers * sizeof(uint32_t) + header.ngates * sizeof(binary_circuit_record)
+					 + header.nangles * 3 * sizeof(double);
+	const uint32_t* sizes = reinterpret_cast<const uint32_t*>(p + sizeof(header));
+	const binary_circuit_record* records = reinterpret_cast<const binary_circuit_record*>(sizes + header.nlayers);
+	//the angle table is only 4 byte aligned (depending on the number of layers and gates), hence it is copied out
+	const char* angles = reinterpret_cast<const char*>(records + header.ngates);
+
+	bool valid = false;
+	if (memcmp(header.magic, binary_circuit_magic, sizeof(header.magic)) != 0) {
+		std::cerr << "ERROR: " << fname << " is not a binary circuit" << std::endl;
+	} else if (header.version != BINARY_CIRCUIT_VERSION) {
+		std::cerr << "ERROR: binary circuit " << fname << " has version " << header.version << ", expected "
+				  << BINARY_CIRCUIT_VERSION << std::endl;
+	} else if (!counts_valid || size != sizeof(header) + payload || fnv1a(p + sizeof(header), payload) != header.checksum) {
+		std::cerr << "ERROR: binary circuit " << fname << " is corrupt" << std::endl;
+	} else {
+		uint64_t total = 0;
+		for (uint64_t i = 0; i < header.nlayers; i++) {
+			total += sizes[i];
+		}
+		valid = total == header.ngates;
+		if (!valid) {
+			std::cerr << "ERROR: binary circuit " << fname << " is corrupt" << std::endl;
+		}
+	}
+
+	if (valid) {
+		//format each distinct U gate only once
+		std::vector<std::string> u_types(header.nangles);
+		for (uint64_t i = 0; i < header.nangles; i++) {
+			double angle[3];
+			memcpy(angle, angles + 3 * i * sizeof(double), sizeof(angle));
+			char type[128];
+			snprintf(type, 127, "U(%f, %f, %f)", angle[0], angle[1], angle[2]);
+			u_types[i] = type;
+		}
+
+		nqubits = header.nqubits;
+		ngates = header.ngates;
+		layers.clear();
+		layers.resize(header.nlayers);
+		const binary_circuit_record* r = records;
+		for (uint64_t i = 0; i < header.nlayers && valid; i++) {
+			layers[i].resize(sizes[i]);
+			for (uint32_t j = 0; j < sizes[i]; j++, r++) {
+				QASMparser::gate& g = layers[i][j];
+				if (r->target >= nqubits || (r->opcode == BINARY_OP_CX && (r->arg >= nqubits || r->arg == r->target))) {
+					std::cerr << "ERROR: binary circuit " << fname << " contains an invalid qubit" << std::endl;
+					valid = false;
+					break;
+				}
+				g.target = r->target;
+				if (r->opcode == BINARY_OP_CX) {
+					g.control = r->arg;
+					strcpy(g.type, "CX");
+				} else if (r->opcode == BINARY_OP_U && r->arg < header.nangles) {
+					g.control = -1;
+					strcpy(g.type, u_types[r->arg].c_str());
+				} else {
+					std::cerr << "ERROR: binary circuit " << fname << " contains an invalid gate" << std::endl;
+					valid = false;
+					break;
+				}
+			}
+		}
+	}
+
+	munmap(data, size);
+	return valid;
+}
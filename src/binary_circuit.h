@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "QASMparser.h"
+
+#ifndef BINARY_CIRCUIT_H
+#define BINARY_CIRCUIT_H
+
+/**
+ * Compact binary image of a parsed, layered circuit which can be loaded without running the QASM parser.
+ *
+ * Layout (native byte order):
+ *   binary_circuit_header
+ *   uint32_t                  size of each layer  [nlayers]
+ *   binary_circuit_record     gates, layer by layer [ngates]
+ *   double                    angle table (theta, phi, lambda) [3 * nangles], only 4 byte aligned
+ * The checksum is the FNV-1a hash of everything following the header.
+ */
+struct binary_circuit_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t nqubits;
+	uint64_t nlayers;
+	uint64_t ngates;
+	uint64_t nangles;
+	uint64_t checksum;
+};
+
+struct binary_circuit_record {
+	uint32_t opcode; // BINARY_OP_CX or BINARY_OP_U
+	uint32_t target;
+	uint32_t arg;    // control qubit of a CX, index into the angle table of a U
+};
+
+#define BINARY_CIRCUIT_VERSION 1
+#define BINARY_OP_CX 0
+#define BINARY_OP_U 1
+
+bool is_binary_circuit(const std::string& fname);
+
+bool write_binary_circuit(const std::string& fname, const std::vector<QASMparser::gate_list>& layers,
+						  unsigned int nqubits);
+
+bool read_binary_circuit(const std::string& fname, std::vector<QASMparser::gate_list>& layers,
+						 unsigned int& nqubits, unsigned long& ngates);
+
+#endif
@@ -0,0 +1,61 @@
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+/**
+ * Blocking FIFO queue with a fixed capacity used to hand elements from a producer thread to a consumer thread.
+ * push() blocks while the queue is full, pop() blocks while the queue is empty and has not been closed.
+ */
+template<class T>
+class bounded_queue
+{
+public:
+    explicit bounded_queue(size_t capacity) : capacity_(capacity) {
+    }
+
+    void push(T&& v)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+        queue_.push_back(std::move(v));
+        not_empty_.notify_one();
+    }
+
+    /**
+     * Return false if the queue has been closed and all elements have been consumed.
+     */
+    bool pop(T& v)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if(queue_.empty()) {
+            return false;
+        }
+        v = std::move(queue_.front());
+        queue_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    /**
+     * Signal that no further elements will be pushed.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_ = false;
+    std::deque<T> queue_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+#endif
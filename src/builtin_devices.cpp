@@ -0,0 +1,4 @@
+#include "builtin_devices.h"
+
+constexpr device_tables<qx5_positions, 2 * sizeof(qx5_pairs) / sizeof(edge)> qx5_tables =
+	make_device_tables<qx5_positions>(qx5_pairs);
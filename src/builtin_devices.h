@@ -0,0 +1,125 @@
+#include "architecture.h"
+#include "dist_table.h"
+
+#ifndef BUILTIN_DEVICES_H
+#define BUILTIN_DEVICES_H
+
+/**
+ * Coupling graph, adjacency index and distance table of a built-in device with N physical qubits and E directed
+ * edges, computed at compile time by make_device_tables(). The layout matches dist_table, so the search can use
+ * the tables in read-only data directly.
+ */
+template<int N, int E>
+struct device_tables {
+	edge edges[E];                 // sorted as in a std::set<edge>
+	int adjacency_offsets[N + 1];  // edges incident to p: adjacency[adjacency_offsets[p]] .. [adjacency_offsets[p+1]-1]
+	edge adjacency[2 * E];
+	int dist[N][N];
+};
+
+template<int P>
+constexpr int device_positions(const edge (&pairs)[P]) {
+	int positions = 0;
+	for (int i = 0; i < P; i++) {
+		positions = positions > pairs[i].v1 + 1 ? positions : pairs[i].v1 + 1;
+		positions = positions > pairs[i].v2 + 1 ? positions : pairs[i].v2 + 1;
+	}
+	return positions;
+}
+
+/**
+ * Build the tables of a device whose P pairs are coupled in both directions. dist[i][j] equals the distance of
+ * build_dist_table(): a shortest path of length L costs (L-1) SWAPs, plus a direction flip unless an edge of some
+ * shortest path is oriented from i towards j.
+ */
+template<int N, int P>
+constexpr device_tables<N, 2 * P> make_device_tables(const edge (&pairs)[P]) {
+	device_tables<N, 2 * P> t{};
+	const int E = 2 * P;
+
+	//edges in std::set<edge> order
+	for (int i = 0; i < P; i++) {
+		t.edges[2 * i] = edge{pairs[i].v1, pairs[i].v2};
+		t.edges[2 * i + 1] = edge{pairs[i].v2, pairs[i].v1};
+	}
+	for (int i = 1; i < E; i++) {
+		edge e = t.edges[i];
+		int j = i;
+		for (; j > 0 && e < t.edges[j - 1]; j--) {
+			t.edges[j] = t.edges[j - 1];
+		}
+		t.edges[j] = e;
+	}
+
+	//adjacency index
+	for (int i = 0; i < E; i++) {
+		t.adjacency_offsets[t.edges[i].v1 + 1]++;
+		t.adjacency_offsets[t.edges[i].v2 + 1]++;
+	}
+	for (int p = 0; p < N; p++) {
+		t.adjacency_offsets[p + 1] += t.adjacency_offsets[p];
+	}
+	int fill[N + 1] = {};
+	for (int i = 0; i < E; i++) {
+		const edge& e = t.edges[i];
+		t.adjacency[t.adjacency_offsets[e.v1] + fill[e.v1]++] = e;
+		t.adjacency[t.adjacency_offsets[e.v2] + fill[e.v2]++] = e;
+	}
+
+	//number of edges on a shortest (undirected) path
+	int hops[N][N] = {};
+	for (int s = 0; s < N; s++) {
+		int queue[N] = {};
+		int head = 0, tail = 0;
+		for (int p = 0; p < N; p++) {
+			hops[s][p] = -1;
+		}
+		hops[s][s] = 0;
+		queue[tail++] = s;
+		while (head < tail) {
+			int p = queue[head++];
+			for (int k = t.adjacency_offsets[p]; k < t.adjacency_offsets[p + 1]; k++) {
+				int q = t.adjacency[k].v1 == p ? t.adjacency[k].v2 : t.adjacency[k].v1;
+				if (hops[s][q] == -1) {
+					hops[s][q] = hops[s][p] + 1;
+					queue[tail++] = q;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < N; i++) {
+		for (int j = 0; j < N; j++) {
+			if (i == j) {
+				continue;
+			}
+			bool forward = false;
+			for (int k = 0; k < E && !forward; k++) {
+				forward = hops[i][t.edges[k].v1] + 1 + hops[t.edges[k].v2][j] == hops[i][j];
+			}
+			t.dist[i][j] = (hops[i][j] - 1) * SWAP_COST + (forward ? 0 : FLIP_COST);
+		}
+	}
+	return t;
+}
+
+//Coupling map of build_graph_QX5(), every pair is coupled in both directions
+constexpr edge qx5_pairs[] = {
+	{0, 6}, {1, 6}, {1, 7}, {2, 7}, {2, 8}, {3, 8}, {3, 9}, {4, 9},
+	{4, 10}, {5, 10}, {5, 11}, {6, 12}, {6, 13}, {7, 13}, {7, 14}, {8, 14},
+	{8, 15}, {9, 15}, {9, 16}, {10, 16}, {10, 17}, {11, 17}, {12, 18}, {13, 18},
+	{13, 19}, {14, 19}, {14, 20}, {15, 20}, {15, 21}, {16, 21}, {16, 22}, {17, 22},
+	{17, 23}, {18, 24}, {18, 25}, {19, 25}, {19, 26}, {20, 26}, {20, 27}, {21, 27},
+	{21, 28}, {22, 28}, {22, 29}, {23, 29}, {24, 30}, {25, 30}, {25, 31}, {26, 31},
+	{26, 32}, {27, 32}, {27, 33}, {28, 33}, {28, 34}, {29, 34}, {29, 35}, {30, 36},
+	{30, 37}, {31, 37}, {31, 38}, {32, 38}, {32, 39}, {33, 39}, {33, 40}, {34, 40},
+	{34, 41}, {35, 41}, {36, 42}, {37, 42}, {37, 43}, {38, 43}, {38, 44}, {39, 44},
+	{39, 45}, {40, 45}, {40, 46}, {41, 46}, {41, 47}, {42, 48}, {42, 49}, {43, 49},
+	{43, 50}, {44, 50}, {44, 51}, {45, 51}, {45, 52}, {46, 52}, {46, 53}, {47, 53}
+};
+
+constexpr int qx5_positions = device_positions(qx5_pairs);
+
+extern const device_tables<qx5_positions, 2 * sizeof(qx5_pairs) / sizeof(edge)> qx5_tables;
+
+#endif
@@ -0,0 +1,266 @@
+#include "dist_table.h"
+#include "builtin_devices.h"
+#include "hash.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIST_CACHE_VERSION 1
+
+/**
+ * Layout of a cache file (native byte order):
+ *   dist_cache_header
+ *   edge     edges of the coupling graph [nedges]
+ *   int32_t  distance table, row by row [positions * positions]
+ *   int32_t  adjacency offsets [positions + 1]
+ *   edge     adjacency [2 * nedges]
+ */
+struct dist_cache_header {
+	char magic[8];
+	uint32_t version;
+	int32_t positions;
+	uint64_t key;
+	uint64_t nedges;
+};
+
+static const char dist_cache_magic[8] = {'Q', 'X', 'M', 'A', 'P', 'D', 'S', 'T'};
+
+static_assert(sizeof(edge) == 2 * sizeof(int32_t), "unexpected layout of edge");
+
+dist_table::~dist_table() {
+	if (mapping != NULL) {
+		munmap(mapping, mapping_size);
+	}
+}
+
+//Distances from start to all physical qubits: a breadth first search determines the length of the shortest paths
+//and, along the DAG of shortest paths, whether one of them contains an edge in the direction from start to goal
+//(otherwise, the CNOT has to be flipped). O(positions + edges) instead of enumerating all shortest paths per pair.
+static void distances_from(int start, const std::vector<std::vector<int> >& neighbours, const std::set<edge>& graph,
+						   std::vector<int>& length, std::vector<char>& forward, std::vector<int>& order, int* row) {
+	int positions = neighbours.size();
+	length.assign(positions, 0);
+	forward.assign(positions, 0);
+	order.clear();
+	order.push_back(start);
+	length[start] = 1;
+	for (size_t k = 0; k < order.size(); k++) {
+		int current = order[k];
+		for (int successor : neighbours[current]) {
+			if (length[successor] == 0) {
+				length[successor] = length[current] + 1;
+				order.push_back(successor);
+			}
+			if (length[successor] == length[current] + 1
+				&& (forward[current] || graph.find(edge{current, successor}) != graph.end())) {
+				forward[successor] = 1;
+			}
+		}
+	}
+	for (int goal = 0; goal < positions; goal++) {
+		if (goal == start) {
+			row[goal] = 0;
+		} else {
+			//length counts the qubits of the path, i.e. a path of length 2 requires no SWAP (0 if unreachable)
+			unsigned long l = length[goal];
+			row[goal] = (l - 2) * SWAP_COST + (forward[goal] ? 0 : FLIP_COST);
+		}
+	}
+}
+
+//Size of the data following the header (in ints)
+static size_t table_size(int positions, size_t nedges) {
+	return 2 * nedges + (size_t) positions * positions + positions + 1 + 4 * nedges;
+}
+
+//Charge the storage of the table (a mapped cache file counts, too, although it is shared with other processes)
+static void account(dist_table& table) {
+	table.charge.set(table.dist.capacity() * sizeof(const int*) + table.data.capacity() * sizeof(int)
+					 + table.mapping_size);
+}
+
+//Set the pointers of the table to data laid out as in a cache file (without header and edge list)
+static void attach(dist_table& table, int positions, const int* data) {
+	table.positions = positions;
+	table.dist.resize(positions);
+	for (int i = 0; i < positions; i++) {
+		table.dist[i] = data + (size_t) i * positions;
+	}
+	table.adjacency_offsets = data + (size_t) positions * positions;
+	table.adjacency = reinterpret_cast<const edge*>(table.adjacency_offsets + positions + 1);
+	account(table);
+}
+
+//Lay out the table as in a cache file (edge list, distances, adjacency index)
+static void compute(const std::set<edge>& graph, int positions, std::vector<int>& data) {
+	data.clear();
+	data.reserve(table_size(positions, graph.size()));
+	for (const edge& e : graph) {
+		data.push_back(e.v1);
+		data.push_back(e.v2);
+	}
+
+	std::vector<std::vector<int> > neighbours(positions);
+	for (const edge& e : graph) {
+		neighbours[e.v1].push_back(e.v2);
+		neighbours[e.v2].push_back(e.v1);
+	}
+	std::vector<int> length;
+	std::vector<char> forward;
+	std::vector<int> order;
+	size_t rows = data.size();
+	data.resize(rows + (size_t) positions * positions);
+	for (int i = 0; i < positions; i++) {
+		distances_from(i, neighbours, graph, length, forward, order, data.data() + rows + (size_t) i * positions);
+	}
+
+	std::vector<std::vector<edge> > incident(positions);
+	for (const edge& e : graph) {
+		incident[e.v1].push_back(e);
+		if (e.v2 != e.v1) {
+			incident[e.v2].push_back(e);
+		}
+	}
+	int offset = 0;
+	for (int i = 0; i < positions; i++) {
+		data.push_back(offset);
+		offset += incident[i].size();
+	}
+	data.push_back(offset);
+	for (int i = 0; i < positions; i++) {
+		for (const edge& e : incident[i]) {
+			data.push_back(e.v1);
+			data.push_back(e.v2);
+		}
+	}
+}
+
+//Use the compile time tables of a built-in device if the graph is that device
+template<int N, int E>
+static bool attach_builtin(const device_tables<N, E>& device, const std::set<edge>& graph, int positions,
+						   dist_table& table) {
+	if (positions != N || graph.size() != E) {
+		return false;
+	}
+	int i = 0;
+	for (const edge& e : graph) {
+		if (e.v1 != device.edges[i].v1 || e.v2 != device.edges[i].v2) {
+			return false;
+		}
+		i++;
+	}
+
+	table.positions = N;
+	table.dist.resize(N);
+	for (int p = 0; p < N; p++) {
+		table.dist[p] = device.dist[p];
+	}
+	table.adjacency_offsets = device.adjacency_offsets;
+	table.adjacency = device.adjacency;
+	account(table);
+	return true;
+}
+
+void build_dist_table(const std::set<edge>& graph, int positions, dist_table& table) {
+	TRACE_SCOPE("build distance table", "positions", positions);
+	if (attach_builtin(qx5_tables, graph, positions, table)) {
+		return;
+	}
+	compute(graph, positions, table.data);
+	attach(table, positions, table.data.data() + 2 * graph.size());
+}
+
+static uint64_t cache_key(const std::set<edge>& graph, int positions) {
+	int32_t constants[4] = {DIST_CACHE_VERSION, positions, SWAP_COST, FLIP_COST};
+	uint64_t key = fnv1a(constants, sizeof(constants));
+	for (const edge& e : graph) {
+		key = fnv1a(&e, sizeof(e), key);
+	}
+	return key;
+}
+
+//Map the cache file read-only; returns false if it does not exist or does not belong to the given graph
+static bool map_cache(const std::string& fname, uint64_t key, const std::set<edge>& graph, int positions,
+					  dist_table& table) {
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+	struct stat st;
+	size_t expected = sizeof(dist_cache_header) + table_size(positions, graph.size()) * sizeof(int);
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t) st.st_size == expected) {
+		mapping = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	const dist_cache_header* header = static_cast<const dist_cache_header*>(mapping);
+	const int* data = reinterpret_cast<const int*>(header + 1);
+	bool valid = memcmp(header->magic, dist_cache_magic, sizeof(header->magic)) == 0
+				 && header->version == DIST_CACHE_VERSION && header->key == key && header->positions == positions
+				 && header->nedges == graph.size();
+	//guard against hash collisions by comparing the edge sets
+	const int* e = data;
+	for (std::set<edge>::const_iterator it = graph.begin(); valid && it != graph.end(); it++, e += 2) {
+		valid = e[0] == it->v1 && e[1] == it->v2;
+	}
+	if (!valid) {
+		munmap(mapping, expected);
+		return false;
+	}
+
+	table.mapping = mapping;
+	table.mapping_size = expected;
+	attach(table, positions, data + 2 * graph.size());
+	return true;
+}
+
+void load_dist_table(const std::string& cache_dir, const std::set<edge>& graph, int positions, dist_table& table) {
+	TRACE_SCOPE("load distance table", "positions", positions);
+	if (attach_builtin(qx5_tables, graph, positions, table)) {
+		return;
+	}
+
+	uint64_t key = cache_key(graph, positions);
+	char name[64];
+	snprintf(name, sizeof(name), "/dist-%016llx.bin", (unsigned long long) key);
+	std::string fname = cache_dir + name;
+
+	if (map_cache(fname, key, graph, positions, table)) {
+		return;
+	}
+
+	build_dist_table(graph, positions, table);
+
+	//Publish atomically: concurrent processes either see no file or a complete one
+	dist_cache_header header;
+	memcpy(header.magic, dist_cache_magic, sizeof(header.magic));
+	header.version = DIST_CACHE_VERSION;
+	header.positions = positions;
+	header.key = key;
+	header.nedges = graph.size();
+
+	std::string tmp = fname + ".tmp." + std::to_string(getpid());
+	FILE* f = fopen(tmp.c_str(), "wb");
+	bool written = f != NULL && fwrite(&header, sizeof(header), 1, f) == 1
+				   && fwrite(table.data.data(), sizeof(int), table.data.size(), f) == table.data.size();
+	if (f != NULL) {
+		written = fclose(f) == 0 && written;
+	}
+	if (!written || rename(tmp.c_str(), fname.c_str()) != 0) {
+		std::cerr << "Warning: could not write distance table cache " << fname << std::endl;
+		remove(tmp.c_str());
+	}
+}
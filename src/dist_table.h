@@ -0,0 +1,50 @@
+#include <set>
+#include <string>
+#include <vector>
+
+#include "architecture.h"
+#include "memory_stats.h"
+
+#ifndef DIST_TABLE_H
+#define DIST_TABLE_H
+
+#define SWAP_COST 7 // a SWAP consists of 3 CNOTs and 4 H gates
+#define FLIP_COST 4 // reversing the direction of a CNOT requires 4 H gates
+
+/**
+ * Distance table and adjacency index of a coupling graph. The data is either computed in memory or mapped
+ * read-only from a cache file shared by all processes mapping to the same architecture.
+ */
+struct dist_table {
+	int positions = 0;
+	// dist[i][j]: cost of the SWAPs (and H gates) required to perform a CNOT between physical qubits i and j
+	std::vector<const int*> dist;
+	// edges incident to physical qubit p (in the order of the coupling graph):
+	// adjacency[adjacency_offsets[p]] .. adjacency[adjacency_offsets[p+1]-1]
+	const int* adjacency_offsets = NULL;
+	const edge* adjacency = NULL;
+
+	dist_table() = default;
+	dist_table(const dist_table&) = delete;
+	dist_table& operator=(const dist_table&) = delete;
+	~dist_table();
+
+	std::vector<int> data;    // storage if computed in memory
+	void* mapping = NULL;     // storage if mapped from a cache file
+	size_t mapping_size = 0;
+	memory_charge charge{memory_category::dist_table};
+};
+
+/**
+ * Compute the distance table of the given coupling graph.
+ */
+void build_dist_table(const std::set<edge>& graph, int positions, dist_table& table);
+
+/**
+ * Load the distance table of the given coupling graph from cache_dir. If there is no such cache file yet, the table
+ * is computed and published atomically in cache_dir (failing to do so only results in a warning).
+ * The cache file is keyed by a hash of the coupling graph and the cost constants.
+ */
+void load_dist_table(const std::string& cache_dir, const std::set<edge>& graph, int positions, dist_table& table);
+
+#endif
@@ -0,0 +1,26 @@
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#ifndef HASH_H
+#define HASH_H
+
+/**
+ * 64 bit FNV-1a hash. Used to key caches by content; it is neither cryptographic nor meant for hash tables.
+ * The running hash can be passed as seed to hash data in several pieces.
+ */
+inline uint64_t fnv1a(const void* data, size_t len, uint64_t seed = 14695981039346656037ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed;
+    for(size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+inline uint64_t fnv1a(const std::string& s, uint64_t seed = 14695981039346656037ull) {
+    return fnv1a(s.data(), s.size(), seed);
+}
+
+#endif
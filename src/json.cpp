@@ -0,0 +1,224 @@
+#include "json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+class json_reader {
+public:
+	json_reader(const std::string& text) : text(text) {
+	}
+
+	bool document(json_value& v) {
+		if (!value(v)) {
+			return false;
+		}
+		skip_whitespace();
+		return pos == text.size() || fail("unexpected trailing characters");
+	}
+
+	std::string error;
+
+private:
+	const std::string& text;
+	size_t pos = 0;
+
+	bool fail(const std::string& message) {
+		error = message + " at offset " + std::to_string(pos);
+		return false;
+	}
+
+	void skip_whitespace() {
+		while (pos < text.size() && strchr(" \t\r\n", text[pos]) != NULL) {
+			pos++;
+		}
+	}
+
+	bool literal(const char* s) {
+		size_t len = strlen(s);
+		if (text.compare(pos, len, s) != 0) {
+			return fail("invalid literal");
+		}
+		pos += len;
+		return true;
+	}
+
+	bool value(json_value& v) {
+		skip_whitespace();
+		if (pos == text.size()) {
+			return fail("unexpected end of input");
+		}
+		char c = text[pos];
+		if (c == '{') {
+			return object(v);
+		} else if (c == '[') {
+			return array(v);
+		} else if (c == '"') {
+			v.kind = json_value::Kind::string;
+			return string(v.string);
+		} else if (c == 't') {
+			v.kind = json_value::Kind::boolean;
+			v.boolean = true;
+			return literal("true");
+		} else if (c == 'f') {
+			v.kind = json_value::Kind::boolean;
+			v.boolean = false;
+			return literal("false");
+		} else if (c == 'n') {
+			v.kind = json_value::Kind::null;
+			return literal("null");
+		}
+		const char* begin = text.c_str() + pos;
+		char* end;
+		v.kind = json_value::Kind::number;
+		v.number = strtod(begin, &end);
+		if (end == begin) {
+			return fail("unexpected character");
+		}
+		pos += end - begin;
+		return true;
+	}
+
+	bool string(std::string& s) {
+		pos++;
+		while (pos < text.size() && text[pos] != '"') {
+			char c = text[pos++];
+			if (c != '\\') {
+				s += c;
+				continue;
+			}
+			if (pos == text.size()) {
+				break;
+			}
+			c = text[pos++];
+			switch (c) {
+				case 'n': s += '\n'; break;
+				case 't': s += '\t'; break;
+				case 'r': s += '\r'; break;
+				case 'b': s += '\b'; break;
+				case 'f': s += '\f'; break;
+				case 'u': {
+					if (pos + 4 > text.size()) {
+						return fail("invalid escape sequence");
+					}
+					unsigned long cp = strtoul(text.substr(pos, 4).c_str(), NULL, 16);
+					pos += 4;
+					//non-ASCII characters do not occur in the files read by this tool
+					s += cp < 0x80 ? (char) cp : '?';
+					break;
+				}
+				default: s += c;
+			}
+		}
+		if (pos == text.size()) {
+			return fail("unterminated string");
+		}
+		pos++;
+		return true;
+	}
+
+	bool array(json_value& v) {
+		v.kind = json_value::Kind::array;
+		pos++;
+		skip_whitespace();
+		if (pos < text.size() && text[pos] == ']') {
+			pos++;
+			return true;
+		}
+		while (true) {
+			v.array.push_back(json_value());
+			if (!value(v.array.back())) {
+				return false;
+			}
+			skip_whitespace();
+			if (pos < text.size() && text[pos] == ',') {
+				pos++;
+			} else if (pos < text.size() && text[pos] == ']') {
+				pos++;
+				return true;
+			} else {
+				return fail("expected ',' or ']'");
+			}
+		}
+	}
+
+	bool object(json_value& v) {
+		v.kind = json_value::Kind::object;
+		pos++;
+		skip_whitespace();
+		if (pos < text.size() && text[pos] == '}') {
+			pos++;
+			return true;
+		}
+		while (true) {
+			skip_whitespace();
+			if (pos == text.size() || text[pos] != '"') {
+				return fail("expected member name");
+			}
+			v.object.push_back(std::make_pair(std::string(), json_value()));
+			if (!string(v.object.back().first)) {
+				return false;
+			}
+			skip_whitespace();
+			if (pos == text.size() || text[pos] != ':') {
+				return fail("expected ':'");
+			}
+			pos++;
+			if (!value(v.object.back().second)) {
+				return false;
+			}
+			skip_whitespace();
+			if (pos < text.size() && text[pos] == ',') {
+				pos++;
+			} else if (pos < text.size() && text[pos] == '}') {
+				pos++;
+				return true;
+			} else {
+				return fail("expected ',' or '}'");
+			}
+		}
+	}
+};
+
+}
+
+const json_value* json_value::get(const std::string& name) const {
+	for (std::vector<std::pair<std::string, json_value> >::const_iterator it = object.begin(); it != object.end(); it++) {
+		if (it->first == name) {
+			return &it->second;
+		}
+	}
+	return NULL;
+}
+
+bool json_parse(const std::string& text, json_value& result, std::string& error) {
+	json_reader reader(text);
+	result = json_value();
+	if (!reader.document(result)) {
+		error = reader.error;
+		return false;
+	}
+	return true;
+}
+
+std::string json_escape(const std::string& s) {
+	std::string result = "\"";
+	for (std::string::const_iterator it = s.begin(); it != s.end(); it++) {
+		unsigned char c = *it;
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		} else if (c == '\n') {
+			result += "\\n";
+		} else if (c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			result += escaped;
+		} else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
@@ -0,0 +1,37 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef JSON_H
+#define JSON_H
+
+/**
+ * Minimal JSON document model, sufficient for coupling maps and result files written by this tool.
+ */
+struct json_value {
+	enum class Kind {null, boolean, number, string, array, object};
+
+	Kind kind = Kind::null;
+	bool boolean = false;
+	double number = 0;
+	std::string string;
+	std::vector<json_value> array;
+	std::vector<std::pair<std::string, json_value> > object;
+
+	/**
+	 * Return the member with the given name or NULL if this is not an object or there is no such member.
+	 */
+	const json_value* get(const std::string& name) const;
+};
+
+/**
+ * Parse the given text. Returns false and describes the problem in error if the text is not valid JSON.
+ */
+bool json_parse(const std::string& text, json_value& result, std::string& error);
+
+/**
+ * Return s as a JSON string literal (including the quotes).
+ */
+std::string json_escape(const std::string& s);
+
+#endif
@@ -0,0 +1,1307 @@
+#include "mapper.h"
+#include "hash.h"
+#include "permutation.h"
+#include "profile.h"
+#include "trace.h"
+#include "unique_priority_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+#define LOOK_AHEAD 1
+#define HEURISTIC_ADMISSIBLE 0
+#define USE_INITIAL_MAPPING 0
+//Devices with more physical qubits are searched in large-device mode: nodes store sparse permutations, are
+//deduplicated by hash and expanded at most once, the successors of a node are single SWAPs next to the qubits of
+//CNOTs that cannot be executed yet (see expand()) and a layer is searched in steps of one more CNOT (see
+//continue_search())
+#define LARGE_DEVICE_POSITIONS 64
+//Weights of the heuristic costs of the layer and of the look-ahead in the priority of a node in large-device mode
+//(weighted A*). With weight 1, a SWAP bringing two qubits closer reduces the heuristic by its own cost, hence all
+//combinations of the progress of independent CNOTs would have the same priority.
+#define LARGE_DEVICE_HEURISTIC_WEIGHT 4
+#define LARGE_DEVICE_LOOK_AHEAD_WEIGHT 2
+//Nodes a search of a layer in large-device mode expands with the SWAPs next to a single CNOT before it is restarted
+//with those of all CNOTs (see focus_search())
+#define LARGE_DEVICE_FOCUS_NODES 64
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+const char* const search_configuration = "LOOK_AHEAD=" STRINGIFY(LOOK_AHEAD)
+										 " HEURISTIC_ADMISSIBLE=" STRINGIFY(HEURISTIC_ADMISSIBLE)
+										 " USE_INITIAL_MAPPING=" STRINGIFY(USE_INITIAL_MAPPING)
+										 " LARGE_DEVICE_POSITIONS=" STRINGIFY(LARGE_DEVICE_POSITIONS)
+										 " LARGE_DEVICE_HEURISTIC_WEIGHT=" STRINGIFY(LARGE_DEVICE_HEURISTIC_WEIGHT)
+										 " LARGE_DEVICE_LOOK_AHEAD_WEIGHT=" STRINGIFY(LARGE_DEVICE_LOOK_AHEAD_WEIGHT)
+										 " LARGE_DEVICE_FOCUS_NODES=" STRINGIFY(LARGE_DEVICE_FOCUS_NODES);
+
+std::shared_ptr<const Architecture> Architecture::create(const std::string& spec, unsigned int nqubits,
+														 const char* dist_cache, std::string& error) {
+	TRACE_SCOPE("create architecture", "spec", spec);
+	static std::atomic<unsigned long> next_id(1);
+	std::shared_ptr<Architecture> arch = std::make_shared<Architecture>();
+	arch->name = spec;
+	arch->id = next_id++;
+	if(!build_architecture(spec, nqubits, arch->graph, arch->positions, error)) {
+		return NULL;
+	}
+	if(dist_cache != NULL) {
+		load_dist_table(dist_cache, arch->graph, arch->positions, arch->table);
+	} else {
+		build_dist_table(arch->graph, arch->positions, arch->table);
+	}
+	arch->dist = arch->table.dist.data();
+	return arch;
+}
+
+template<class Permutation>
+struct node {
+	int cost_fixed;
+	int cost_heur;
+	int cost_heur2;
+	int depth;
+	Permutation mapping; // qubit of a location and location of a qubit, see permutation.h
+	int nswaps;
+	int done;
+	int last_swap; // index of the last SWAP in MappingContext::swap_log
+	unsigned int id; // only set if the search is traced (see MappingContext::search_trace)
+};
+
+template<class Permutation>
+struct node_func_less {
+	// true iff x < y
+	bool operator()(const node<Permutation>& x, const node<Permutation>& y) const {
+		return x.mapping < y.mapping;
+	}
+};
+
+template<class Permutation>
+struct node_hash {
+	size_t operator()(const node<Permutation>& x) const {
+		return x.mapping.hash();
+	}
+};
+
+template<class Permutation>
+struct node_equal {
+	bool operator()(const node<Permutation>& x, const node<Permutation>& y) const {
+		return x.mapping == y.mapping;
+	}
+};
+
+//Weights of cost_heur and cost_heur2 in the priority of a node
+template<class Permutation>
+struct heuristic_weights {
+	static const int layer = 1;
+	static const int look_ahead = 1;
+};
+
+template<>
+struct heuristic_weights<sparse_permutation> {
+	static const int layer = LARGE_DEVICE_HEURISTIC_WEIGHT;
+	static const int look_ahead = LARGE_DEVICE_LOOK_AHEAD_WEIGHT;
+};
+
+template<class Permutation>
+struct node_cost_greater {
+	static int priority(const node<Permutation>& x) {
+		return x.cost_fixed + heuristic_weights<Permutation>::layer * x.cost_heur
+			   + heuristic_weights<Permutation>::look_ahead * x.cost_heur2;
+	}
+
+	// true iff x > y
+	bool operator()(const node<Permutation>& x, const node<Permutation>& y) const {
+		if (priority(x) != priority(y)) {
+			return priority(x) > priority(y);
+		}
+
+		if(x.done == 1) {
+			return false;
+		}
+		if(y.done == 1) {
+			return true;
+		}
+
+		if (x.cost_heur + x.cost_heur2 != y.cost_heur + y.cost_heur2) {
+			return x.cost_heur + x.cost_heur2 > y.cost_heur + y.cost_heur2;
+		} else {
+			return node_func_less<Permutation>{}(x, y);
+		}
+
+	}
+};
+
+struct permutation_hash {
+	template<class Permutation>
+	size_t operator()(const Permutation& p) const {
+		return p.hash();
+	}
+};
+
+//Set of the queued nodes, ordered by their permutation
+template<class Permutation>
+struct node_set {
+	typedef std::set<node<Permutation>, node_func_less<Permutation>,
+					 counting_allocator<node<Permutation>, memory_category::search_set> > type;
+	static const bool lazy_replacement = false;
+};
+
+//On large devices, comparing permutations is replaced by comparing their hashes (and their few changes on collision).
+//As a permutation is expanded at most once, a node replaced by a cheaper one may stay in the heap (see
+//unique_priority_queue) instead of rebuilding the heap of a large queue.
+template<>
+struct node_set<sparse_permutation> {
+	typedef std::unordered_set<node<sparse_permutation>, node_hash<sparse_permutation>, node_equal<sparse_permutation>,
+							   counting_allocator<node<sparse_permutation>, memory_category::search_set> > type;
+	static const bool lazy_replacement = true;
+};
+
+template<class Permutation>
+struct search_state {
+	const Architecture& arch;
+	MappingContext& context;
+	unique_priority_queue<node<Permutation>, do_nothing<node<Permutation> >, node_cost_greater<Permutation>,
+						  node_func_less<Permutation>,
+						  counting_allocator<node<Permutation>, memory_category::search_queue>,
+						  counting_allocator<node<Permutation>, memory_category::search_set>,
+						  typename node_set<Permutation>::type, node_set<Permutation>::lazy_replacement> nodes;
+	swap_history& swaps; // SWAPs of all generated nodes
+	layer_telemetry stats = layer_telemetry();
+	search_trace_writer* trace;
+	unsigned int next_id = 0;
+	// permutations expanded so far in large-device mode (see first_expansion())
+	std::unordered_set<Permutation, permutation_hash, std::equal_to<Permutation>,
+					   counting_allocator<Permutation, memory_category::search_set> > expanded;
+	// CNOT of each logical qubit in the layer and in the next layer containing a CNOT (large-device mode, see expand())
+	std::vector<const QASMparser::gate*> layer_gate;
+	std::vector<const QASMparser::gate*> next_gate;
+	// large-device mode: nodes with at most goal_far CNOTs that cannot be executed yet are done (-1 until the first
+	// expansion), the root of the current search and the SWAPs it is restricted to (see focus_search())
+	int goal_far = -1;
+	node<Permutation> root;
+	std::vector<edge> focus;
+	std::vector<char> far_at_root; // per gate of the layer
+	std::vector<edge> candidates;
+	// CNOTs of the next layer with one unmapped qubit, their look-ahead cost in the node expanded and the number of
+	// free locations at that distance (large-device mode)
+	struct half_mapped_cnot {
+		const QASMparser::gate* g;
+		int cost;
+		int nearest;
+	};
+	std::vector<half_mapped_cnot> half_mapped;
+	// breadth first search for free locations in large-device mode (see free_distance())
+	std::vector<unsigned int> visited;
+	unsigned int visit_mark = 0;
+	std::vector<int> ring;
+	std::vector<int> next_ring;
+
+	search_state(const Architecture& arch, MappingContext& context)
+		: arch(arch), context(context), swaps(context.swap_log), trace(context.search_trace) {
+		swaps.clear();
+	}
+};
+
+//Record a generated node in the search trace
+template<class Permutation>
+void trace_node(search_state<Permutation>& search, const node<Permutation>& n, unsigned int parent, const edge* swaps,
+				int nswaps, bool inserted) {
+	uint64_t h = fnv1a(NULL, 0);
+	for (int l = 0; l < search.arch.positions; l++) {
+		int q = n.mapping.qubit(l);
+		h = fnv1a(&q, sizeof(q), h);
+	}
+	search.trace->node(n.id, parent, n.cost_fixed, n.cost_heur, n.cost_heur2, n.done, inserted, h, swaps, nswaps);
+}
+
+//Append the statistics of the search of a layer to the telemetry, n being the node found (or the last one expanded)
+template<class Permutation>
+void record_telemetry(search_state<Permutation>& search, const node<Permutation>& n,
+					  std::chrono::steady_clock::time_point begin) {
+	if(!search.context.record_telemetry) {
+		return;
+	}
+	layer_telemetry& stats = search.stats;
+	stats.queue_replacements = search.nodes.replacements();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	stats.cost_fixed = n.cost_fixed;
+	stats.cost_heur = n.cost_heur;
+	stats.cost_heur2 = n.cost_heur2;
+	search.context.telemetry.push_back(stats);
+}
+
+bool layer_memo::find(const std::vector<int>& key, layer_result& result) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::unordered_map<uint64_t, std::list<entry>::iterator>::iterator it =
+		index_.find(fnv1a(key.data(), key.size() * sizeof(int)));
+	if(it == index_.end() || it->second->key != key) {
+		return false;
+	}
+	entries_.splice(entries_.begin(), entries_, it->second);
+	result = it->second->result;
+	return true;
+}
+
+void layer_memo::insert(const std::vector<int>& key, const layer_result& result) {
+	uint64_t h = fnv1a(key.data(), key.size() * sizeof(int));
+	std::lock_guard<std::mutex> lock(mutex_);
+	if(capacity_ == 0 || index_.find(h) != index_.end()) {
+		return;
+	}
+	entries_.push_front(entry{key, result});
+	index_[h] = entries_.begin();
+	if(entries_.size() > capacity_) {
+		index_.erase(fnv1a(entries_.back().key.data(), entries_.back().key.size() * sizeof(int)));
+		entries_.pop_back();
+	}
+}
+
+//Everything the search of a layer depends on: the architecture, the CNOTs of the layer and of the next layer
+//containing a CNOT, and the current mapping
+static void memo_key(const Architecture& arch, const MappingContext& context, int layer, int next_layer,
+					 const int* map, const int* loc, std::vector<int>& key) {
+	key.clear();
+	key.push_back((int) arch.id);
+	key.push_back((int) context.nqubits);
+	for(int l : {layer, next_layer}) {
+		if(l == -1) {
+			continue;
+		}
+		key.push_back(-1);
+		for(QASMparser::gate_list::const_iterator it = context.layers[l].begin(); it != context.layers[l].end(); it++) {
+			if(it->control != -1) {
+				key.push_back(it->control);
+				key.push_back(it->target);
+			}
+		}
+	}
+	key.push_back(-1);
+	key.insert(key.end(), map, map + arch.positions);
+	key.insert(key.end(), loc, loc + context.nqubits);
+}
+
+//False if the permutation of the node has been expanded before (only tracked in large-device mode)
+template<class Permutation>
+bool first_expansion(search_state<Permutation>&, const node<Permutation>&) {
+	return true;
+}
+
+bool first_expansion(search_state<sparse_permutation>& search, const node<sparse_permutation>& n) {
+	return search.expanded.insert(n.mapping).second;
+}
+
+//Minimal distance between location and a free location (from the free location to location if to_location is
+//set, otherwise from location to the free location), 1000 if there is no free location
+template<class Permutation>
+int free_distance(search_state<Permutation>& search, const Permutation& mapping, int location, bool to_location) {
+	const int* const* dist = search.arch.dist;
+	int min = 1000;
+	for(int i=0; i< search.arch.positions; i++) {
+		int d = to_location ? dist[i][location] : dist[location][i];
+		if(mapping.qubit(i) == -1 && d < min) {
+			min = d;
+		}
+	}
+	return min;
+}
+
+//On large devices, only the nearest free locations are visited: breadth first search ring by ring, the distances of
+//the qubits of a ring (k SWAPs plus a possible flip) being smaller than those of the next ring. nearest receives the
+//number of free locations at the distance returned.
+int free_distance(search_state<sparse_permutation>& search, const sparse_permutation& mapping, int location,
+				  bool to_location, int* nearest = NULL) {
+	const int* const* dist = search.arch.dist;
+	const dist_table& table = search.arch.table;
+	if(search.visited.size() != (size_t) search.arch.positions || search.visit_mark == (unsigned int) -1) {
+		search.visited.assign(search.arch.positions, 0);
+		search.visit_mark = 0;
+	}
+	unsigned int mark = ++search.visit_mark;
+	search.visited[location] = mark;
+	search.ring.assign(1, location);
+	while(!search.ring.empty()) {
+		int min = 1000;
+		int count = 0;
+		search.next_ring.clear();
+		for(int l : search.ring) {
+			if(mapping.qubit(l) == -1) {
+				int d = to_location ? dist[l][location] : dist[location][l];
+				count = d < min ? 1 : count + (d == min);
+				min = std::min(min, d);
+			}
+			for(int k = table.adjacency_offsets[l]; k < table.adjacency_offsets[l + 1]; k++) {
+				int other = table.adjacency[k].v1 == l ? table.adjacency[k].v2 : table.adjacency[k].v1;
+				if(search.visited[other] != mark) {
+					search.visited[other] = mark;
+					search.next_ring.push_back(other);
+				}
+			}
+		}
+		if(min != 1000) {
+			if(nearest != NULL) {
+				*nearest = count;
+			}
+			return min;
+		}
+		search.ring.swap(search.next_ring);
+	}
+	return 1000;
+}
+
+//Apply the given SWAPs to a copy of base_node (the costs of the new node remain to be calculated)
+template<class Permutation>
+void apply_swaps(const edge* swaps, int nswaps, const node<Permutation>& base_node, node<Permutation>& new_node,
+				 search_state<Permutation>& search) {
+	new_node = base_node;
+
+	new_node.nswaps = base_node.nswaps + nswaps;
+
+	new_node.depth = base_node.depth + 5;
+	new_node.cost_fixed = base_node.cost_fixed + 7 * nswaps;
+	new_node.cost_heur = 0;
+
+	for (int i = 0; i < nswaps; i++) {
+		new_node.mapping.swap(swaps[i].v1, swaps[i].v2);
+		search.swaps.push_back(swap_step{new_node.last_swap, swaps[i]});
+		new_node.last_swap = search.swaps.size() - 1;
+	}
+}
+
+//Insert a new node into the queue
+template<class Permutation>
+void insert_node(node<Permutation>& new_node, const node<Permutation>& base_node, const edge* swaps, int nswaps,
+				 search_state<Permutation>& search) {
+	PROFILE_COUNT(search_node);
+	search.stats.nodes_generated++;
+	if(search.trace != NULL) {
+		new_node.id = search.next_id++;
+	}
+	bool inserted = search.nodes.push(new_node);
+	if(!inserted) {
+		search.stats.duplicates_rejected++;
+	}
+	if(search.trace != NULL) {
+		trace_node(search, new_node, base_node.id, swaps, nswaps, inserted);
+	}
+}
+
+//Heuristic cost of a CNOT of the next layer, as long as its qubits are not both unmapped
+template<class Permutation>
+int look_ahead_cost(search_state<Permutation>& search, const Permutation& mapping, const QASMparser::gate& g) {
+	int control = mapping.location(g.control);
+	int target = mapping.location(g.target);
+	if(control == -1 && target == -1) {
+		//No additional penalty in heuristics
+		return 0;
+	} else if(control == -1) {
+		return free_distance(search, mapping, target, true);
+	} else if(target == -1) {
+		return free_distance(search, mapping, control, false);
+	}
+	return search.arch.dist[control][target];
+}
+
+//Create the node reached from base_node by the given SWAPs and insert it into the queue
+template<class Permutation>
+void generate_node(const edge* swaps, int nswaps, const node<Permutation>& base_node,
+				   const QASMparser::gate_list& gates, int next_layer, search_state<Permutation>& search) {
+	const int* const* dist = search.arch.dist;
+	node<Permutation> new_node;
+	apply_swaps(swaps, nswaps, base_node, new_node, search);
+	new_node.done = 1;
+
+	{
+		PROFILE_TIMER(heuristic);
+		for (QASMparser::gate_list::const_iterator it = gates.begin(); it != gates.end();
+			 it++) {
+			const QASMparser::gate& g = *it;
+			if (g.control != -1) {
+#if HEUR_ADMISSIBLE
+				new_node.cost_heur = max(new_node.cost_heur, dist[new_node.mapping.location(g.control)][new_node.mapping.location(g.target)]);
+#else
+				new_node.cost_heur = new_node.cost_heur + dist[new_node.mapping.location(g.control)][new_node.mapping.location(g.target)];
+#endif
+				if(dist[new_node.mapping.location(g.control)][new_node.mapping.location(g.target)] > 4) {
+					new_node.done = 0;
+				}
+			}
+		}
+	}
+
+	//Calculate heuristics for the cost of the following layer
+	new_node.cost_heur2 = 0;
+#if LOOK_AHEAD
+	if(next_layer != -1) {
+		PROFILE_TIMER(look_ahead);
+		for (QASMparser::gate_list::const_iterator it = search.context.layers[next_layer].begin(); it != search.context.layers[next_layer].end();
+						it++) {
+			const QASMparser::gate& g = *it;
+			if (g.control != -1) {
+#if HEURISTIC_ADMISSIBLE
+				if(new_node.mapping.location(g.control) != -1 && new_node.mapping.location(g.target) != -1) {
+					new_node.cost_heur2 = max(new_node.cost_heur2, dist[new_node.mapping.location(g.control)][new_node.mapping.location(g.target)]);
+					continue;
+				}
+#endif
+				new_node.cost_heur2 = new_node.cost_heur2 + look_ahead_cost(search, new_node.mapping, g);
+			}
+		}
+	}
+#endif
+
+	insert_node(new_node, base_node, swaps, nswaps, search);
+}
+
+template<class Permutation>
+void expand_node(const std::vector<int>& qubits, unsigned int qubit, edge *swaps, int nswaps,
+				 int* used, const node<Permutation>& base_node, const QASMparser::gate_list& gates, int next_layer,
+				 search_state<Permutation>& search) {
+	PROFILE_COUNT(expand_node);
+
+	if (qubit == qubits.size()) {
+		//base case: insert node into queue
+		if (nswaps == 0) {
+			return;
+		}
+		generate_node(swaps, nswaps, base_node, gates, next_layer, search);
+	} else {
+		expand_node(qubits, qubit + 1, swaps, nswaps, used, base_node, gates,
+					next_layer, search);
+
+		int location = base_node.mapping.location(qubits[qubit]);
+		const dist_table& table = search.arch.table;
+		for (int k = table.adjacency_offsets[location]; k < table.adjacency_offsets[location + 1]; k++) {
+			edge e = table.adjacency[k];
+			if (!used[e.v1] && !used[e.v2]) {
+				used[e.v1] = 1;
+				used[e.v2] = 1;
+				swaps[nswaps].v1 = e.v1;
+				swaps[nswaps].v2 = e.v2;
+				expand_node(qubits, qubit + 1, swaps, nswaps + 1, used,
+							base_node, gates, next_layer, search);
+				used[e.v1] = 0;
+				used[e.v2] = 0;
+			}
+		}
+	}
+}
+
+//Successors of a node: all sets of disjoint SWAPs on edges incident to the qubits of the CNOTs
+template<class Permutation>
+void expand(const std::vector<int>& qubits, edge* swaps, int* used, const node<Permutation>& base_node,
+			const QASMparser::gate_list& gates, int next_layer, search_state<Permutation>& search) {
+	expand_node(qubits, 0, swaps, 0, used, base_node, gates, next_layer, search);
+}
+
+//Cost of a CNOT of the layer and of the next layer (0 for NULL) in the given permutation
+static int layer_cost(const int* const* dist, const sparse_permutation& mapping, const QASMparser::gate* g) {
+	return g == NULL ? 0 : dist[mapping.location(g->control)][mapping.location(g->target)];
+}
+
+static int next_layer_cost(search_state<sparse_permutation>& search, const sparse_permutation& mapping,
+						   const QASMparser::gate* g) {
+	return g == NULL ? 0 : look_ahead_cost(search, mapping, *g);
+}
+
+static bool is_half_mapped(const sparse_permutation& mapping, const QASMparser::gate& g) {
+	return (mapping.location(g.control) == -1) != (mapping.location(g.target) == -1);
+}
+
+//Number of CNOTs of the layer that cannot be executed in the given permutation
+static int far_cnots(const int* const* dist, const sparse_permutation& mapping, const QASMparser::gate_list& gates) {
+	int far = 0;
+	for (const QASMparser::gate& g : gates) {
+		if (g.control != -1 && layer_cost(dist, mapping, &g) > 4) {
+			far++;
+		}
+	}
+	return far;
+}
+
+//Number of edges on a shortest path from start to each location
+static void hop_distances(const dist_table& table, int start, std::vector<int>& hops) {
+	hops.assign(table.positions, -1);
+	std::vector<int> queue(1, start);
+	hops[start] = 0;
+	for (size_t i = 0; i < queue.size(); i++) {
+		int l = queue[i];
+		for (int k = table.adjacency_offsets[l]; k < table.adjacency_offsets[l + 1]; k++) {
+			int other = table.adjacency[k].v1 == l ? table.adjacency[k].v2 : table.adjacency[k].v1;
+			if (hops[other] == -1) {
+				hops[other] = hops[l] + 1;
+				queue.push_back(other);
+			}
+		}
+	}
+}
+
+//Start a search from root for a node executing at least one more CNOT of the layer. The SWAPs are restricted to the
+//edges incident to the shortest paths between the qubits of the nearest CNOT that cannot be executed yet, i.e. the
+//qubits of the CNOT and those in their way, and to the edges incident to the qubits of the CNOTs these SWAPs make
+//unexecutable (see expand()). The other CNOTs would multiply the nodes of a plateau of the heuristic by their SWAPs.
+static void focus_search(search_state<sparse_permutation>& search, const node<sparse_permutation>& root,
+						 const QASMparser::gate_list& gates) {
+	const int* const* dist = search.arch.dist;
+	const dist_table& table = search.arch.table;
+	search.goal_far = -1;
+	search.root = root;
+	search.focus.clear();
+	search.far_at_root.assign(gates.size(), 0);
+	const QASMparser::gate* nearest = NULL;
+	for (const QASMparser::gate& g : gates) {
+		int cost = g.control != -1 ? layer_cost(dist, root.mapping, &g) : 0;
+		if (cost > 4) {
+			search.goal_far++;
+			search.far_at_root[&g - gates.data()] = 1;
+			if (nearest == NULL || cost < layer_cost(dist, root.mapping, nearest)) {
+				nearest = &g;
+			}
+		}
+	}
+	if (nearest == NULL) {
+		return;
+	}
+	int control = root.mapping.location(nearest->control);
+	int target = root.mapping.location(nearest->target);
+	std::vector<int> from_control, from_target;
+	hop_distances(table, control, from_control);
+	hop_distances(table, target, from_target);
+	for (int l = 0; l < table.positions; l++) {
+		if (from_control[l] + from_target[l] == from_control[target]) {
+			search.focus.insert(search.focus.end(), table.adjacency + table.adjacency_offsets[l],
+								table.adjacency + table.adjacency_offsets[l + 1]);
+		}
+	}
+	std::sort(search.focus.begin(), search.focus.end());
+	search.focus.erase(std::unique(search.focus.begin(), search.focus.end(), [](const edge& x, const edge& y) {
+		return x.v1 == y.v1 && x.v2 == y.v2;
+	}), search.focus.end());
+}
+
+//Whether to restart the search with more SWAPs, i.e. in large-device mode with all SWAPs next to the CNOTs that cannot
+//be executed yet if the restricted SWAPs are exhausted or the search expanded too many nodes with them
+template<class Permutation>
+bool widen_search(search_state<Permutation>&) {
+	return false;
+}
+
+bool widen_search(search_state<sparse_permutation>& search) {
+	if (search.focus.empty() || (!search.nodes.empty() && search.expanded.size() < LARGE_DEVICE_FOCUS_NODES)) {
+		return false;
+	}
+	search.focus.clear();
+	search.nodes = decltype(search.nodes)();
+	search.expanded.clear();
+	search.nodes.push(search.root);
+	return true;
+}
+
+//Whether to search on from the node found, i.e. in large-device mode if it does not yet execute all CNOTs
+template<class Permutation>
+bool continue_search(search_state<Permutation>&, const QASMparser::gate_list&) {
+	return false;
+}
+
+//In large-device mode, the search of a layer is split into searches for a node executing at least one more CNOT,
+//each starting from the node found by the previous one. A single search would have to explore all combinations of
+//the SWAPs that make no progress at the CNOTs of the layer when reaching a local minimum of the heuristic.
+bool continue_search(search_state<sparse_permutation>& search, const QASMparser::gate_list& gates) {
+	node<sparse_permutation> root = search.nodes.top();
+	int far = far_cnots(search.arch.dist, root.mapping, gates);
+	if (far == 0) {
+		return false;
+	}
+	search.nodes = decltype(search.nodes)();
+	search.expanded.clear();
+	root.done = 0;
+	root.mapping.rebase();
+	focus_search(search, root, gates);
+	search.nodes.push(root);
+	return true;
+}
+
+//Successors of a node on a large device: single SWAPs (sets of disjoint SWAPs are reached as sequences of these) on
+//the edges of the search (see focus_search()) or, once these are exhausted, on the edges incident to the qubits of
+//all CNOTs that cannot be executed yet. SWAPs on shortest paths between the qubits of a CNOT reduce the weighted
+//heuristic and are hence explored first; the others are required where CNOTs compete for a qubit with only two
+//neighbours (e.g. a bridge of a heavy-hex device), which the qubits of both CNOTs would otherwise alternately occupy.
+//A SWAP only changes the costs of the CNOTs of its two qubits, hence the costs of the new nodes are derived from those
+//of base_node.
+void expand(const std::vector<int>&, edge* swaps, int*, const node<sparse_permutation>& base_node,
+			const QASMparser::gate_list& gates, int next_layer, search_state<sparse_permutation>& search) {
+#if HEURISTIC_ADMISSIBLE || !LOOK_AHEAD
+	bool incremental = false;
+#else
+	bool incremental = true;
+#endif
+	const int* const* dist = search.arch.dist;
+	const dist_table& table = search.arch.table;
+	const std::vector<QASMparser::gate_list>& layers = search.context.layers;
+	PROFILE_COUNT(expand_node);
+	if (search.layer_gate.empty()) {
+		search.layer_gate.assign(search.context.nqubits, NULL);
+		search.next_gate.assign(search.context.nqubits, NULL);
+		for (const QASMparser::gate& g : gates) {
+			if (g.control != -1) {
+				search.layer_gate[g.control] = search.layer_gate[g.target] = &g;
+			}
+		}
+		if (next_layer != -1) {
+			for (const QASMparser::gate& g : layers[next_layer]) {
+				if (g.control != -1) {
+					search.next_gate[g.control] = search.next_gate[g.target] = &g;
+				}
+			}
+		}
+	}
+
+	if (search.goal_far == -1) {
+		focus_search(search, base_node, gates);
+	}
+
+	//Costs of base_node (the root of a layer has other costs) and the SWAPs to consider
+	int cost_heur = 0;
+	int far = 0;
+	int ncandidates = 0;
+	for (const QASMparser::gate& g : gates) {
+		if (g.control == -1) {
+			continue;
+		}
+		int cost = layer_cost(dist, base_node.mapping, &g);
+		cost_heur += cost;
+		if (cost <= 4) {
+			continue;
+		}
+		far++;
+		if (!search.focus.empty() && search.far_at_root[&g - gates.data()]) {
+			continue;
+		}
+		for (int location : {base_node.mapping.location(g.control), base_node.mapping.location(g.target)}) {
+			for (int k = table.adjacency_offsets[location]; k < table.adjacency_offsets[location + 1]; k++) {
+				swaps[ncandidates++] = table.adjacency[k];
+			}
+		}
+	}
+	int cost_heur2 = 0;
+	search.half_mapped.clear();
+	if (incremental && next_layer != -1) {
+		for (const QASMparser::gate& g : layers[next_layer]) {
+			if (g.control == -1) {
+				continue;
+			}
+			int control = base_node.mapping.location(g.control);
+			int target = base_node.mapping.location(g.target);
+			if ((control == -1) != (target == -1)) {
+				int nearest = 0;
+				int cost = control == -1 ? free_distance(search, base_node.mapping, target, true, &nearest)
+										 : free_distance(search, base_node.mapping, control, false, &nearest);
+				cost_heur2 += cost;
+				search.half_mapped.push_back(search_state<sparse_permutation>::half_mapped_cnot{&g, cost, nearest});
+			} else {
+				cost_heur2 += look_ahead_cost(search, base_node.mapping, g);
+			}
+		}
+	}
+
+	if (!search.focus.empty()) {
+		search.candidates.assign(search.focus.begin(), search.focus.end());
+		search.candidates.insert(search.candidates.end(), swaps, swaps + ncandidates);
+		swaps = search.candidates.data();
+		ncandidates = search.candidates.size();
+	}
+	//an edge may be incident to the qubits of two CNOTs
+	std::sort(swaps, swaps + ncandidates);
+	ncandidates = std::unique(swaps, swaps + ncandidates, [](const edge& x, const edge& y) {
+		return x.v1 == y.v1 && x.v2 == y.v2;
+	}) - swaps;
+	node<sparse_permutation> new_node;
+	for (int i = 0; i < ncandidates; i++) {
+		int q1 = base_node.mapping.qubit(swaps[i].v1);
+		int q2 = base_node.mapping.qubit(swaps[i].v2);
+		if (q1 == -1 && q2 == -1) {
+			continue;
+		}
+		if (!incremental) {
+			generate_node(swaps + i, 1, base_node, gates, next_layer, search);
+			continue;
+		}
+		const QASMparser::gate* g1 = q1 != -1 ? search.layer_gate[q1] : NULL;
+		const QASMparser::gate* g2 = q2 != -1 && search.layer_gate[q2] != g1 ? search.layer_gate[q2] : NULL;
+		const QASMparser::gate* n1 = q1 != -1 ? search.next_gate[q1] : NULL;
+		const QASMparser::gate* n2 = q2 != -1 && search.next_gate[q2] != n1 ? search.next_gate[q2] : NULL;
+		//moving a qubit to a free location changes the costs of all CNOTs of the next layer with an unmapped qubit
+		bool free_moved = !search.half_mapped.empty() && (q1 == -1 || q2 == -1);
+		if (free_moved) {
+			n1 = n1 != NULL && is_half_mapped(base_node.mapping, *n1) ? NULL : n1;
+			n2 = n2 != NULL && is_half_mapped(base_node.mapping, *n2) ? NULL : n2;
+		}
+
+		int before = layer_cost(dist, base_node.mapping, g1) + layer_cost(dist, base_node.mapping, g2);
+		int far_before = (layer_cost(dist, base_node.mapping, g1) > 4) + (layer_cost(dist, base_node.mapping, g2) > 4);
+		int next_before = next_layer_cost(search, base_node.mapping, n1) + next_layer_cost(search, base_node.mapping, n2);
+
+		apply_swaps(swaps + i, 1, base_node, new_node, search);
+		int after = layer_cost(dist, new_node.mapping, g1) + layer_cost(dist, new_node.mapping, g2);
+		int far_after = (layer_cost(dist, new_node.mapping, g1) > 4) + (layer_cost(dist, new_node.mapping, g2) > 4);
+		new_node.cost_heur = cost_heur - before + after;
+		new_node.done = far - far_before + far_after <= search.goal_far;
+		new_node.cost_heur2 = cost_heur2 - next_before + next_layer_cost(search, new_node.mapping, n1)
+							  + next_layer_cost(search, new_node.mapping, n2);
+		if (free_moved) {
+			//the free location moves from filled to emptied, a neighbour
+			int filled = q1 == -1 ? swaps[i].v1 : swaps[i].v2;
+			int emptied = q1 == -1 ? swaps[i].v2 : swaps[i].v1;
+			for (const search_state<sparse_permutation>::half_mapped_cnot& h : search.half_mapped) {
+				int control = new_node.mapping.location(h.g->control);
+				int target = new_node.mapping.location(h.g->target);
+				int cost;
+				if (control == filled || target == filled) {
+					cost = look_ahead_cost(search, new_node.mapping, *h.g);
+				} else if ((control == -1 ? dist[filled][target] : dist[control][filled]) > h.cost || h.nearest > 1) {
+					//a nearest free location remains free
+					cost = std::min(h.cost, control == -1 ? dist[emptied][target] : dist[control][emptied]);
+				} else {
+					cost = look_ahead_cost(search, new_node.mapping, *h.g);
+				}
+				new_node.cost_heur2 += cost - h.cost;
+			}
+		}
+		insert_node(new_node, base_node, swaps + i, 1, search);
+	}
+}
+
+unsigned int MappingContext::getNextLayer(unsigned int layer) const {
+	unsigned int next_layer = layer+1;
+	while(next_layer < layers.size()) {
+		for(QASMparser::gate_list::const_iterator it = layers[next_layer].begin(); it != layers[next_layer].end(); it++) {
+			if(it->control != -1) {
+				return next_layer;
+			}
+		}
+		next_layer++;
+	}
+	return -1;
+}
+
+bool MappingContext::receive_layers(unsigned int layer) {
+	if(layer_stream != NULL) {
+		while(layers.size() <= layer || getNextLayer(layer) == (unsigned int) -1) {
+			QASMparser::gate_list v;
+			if(!layer_stream->pop(v)) {
+				break;
+			}
+			layers.push_back(std::move(v));
+		}
+	}
+	return layer < layers.size();
+}
+
+//Single qubit gates waiting for their qubit to be placed and the gates behind them, charged to the output
+typedef std::vector<QASMparser::gate, counting_allocator<QASMparser::gate, memory_category::output> > pending_gates;
+
+//Writes the gates of the mapped circuit as they are produced and keeps track of its depth.
+//Once a single qubit gate of a logical qubit that has not been placed yet occurs, the gates are held back
+//until its physical qubit is known. SWAPs are recorded among them so that release() can trace the
+//physical qubit back to the position its content had when the gate occurred.
+struct circuit_emitter {
+	QASMwriter* out;
+	std::vector<int> last_layer;
+	int depth = 0;
+	unsigned long ngates = 0;
+	pending_gates held;
+	std::vector<char> waiting; //logical qubits with held gates whose physical qubit is not known yet
+	int nwaiting = 0;
+
+	circuit_emitter(QASMwriter* out, int positions, int nqubits) : out(out), last_layer(positions, -1), waiting(nqubits, 0) {
+	}
+
+	void emit(const QASMparser::gate& g) {
+		if (!held.empty()) {
+			held.push_back(g);
+		} else {
+			write(g);
+		}
+	}
+
+	//Hold back a single qubit gate of a logical qubit which has not been placed yet (marked by a negative target)
+	void emit_unplaced(QASMparser::gate g) {
+		if (!waiting[g.target]) {
+			waiting[g.target] = 1;
+			nwaiting++;
+		}
+		g.target = -g.target - 1;
+		held.push_back(g);
+	}
+
+	void swap(int v1, int v2) {
+		if (!held.empty()) {
+			QASMparser::gate g;
+			strcpy(g.type, "SWP");
+			g.control = v1;
+			g.target = v2;
+			held.push_back(g);
+		}
+	}
+
+	void placed(int qubit) {
+		if (waiting[qubit]) {
+			waiting[qubit] = 0;
+			nwaiting--;
+		}
+	}
+
+	//Write the held gates once all of their logical qubits are placed. The mapping (locations, qubits) is
+	//the one after the last held gate; the held SWAPs are undone backwards to find each physical qubit.
+	void release(const int* locations, const int* qubits, int nqubits, int positions) {
+		if (held.empty() || nwaiting != 0) {
+			return;
+		}
+		TRACE_SCOPE("release held gates", "gates", held.size());
+		std::vector<int> loc(locations, locations + nqubits);
+		std::vector<int> map(qubits, qubits + positions);
+		for (pending_gates::reverse_iterator it = held.rbegin(); it != held.rend(); it++) {
+			if (strcmp(it->type, "SWP") == 0) {
+				std::swap(map[it->control], map[it->target]);
+				if (map[it->control] != -1) {
+					loc[map[it->control]] = it->control;
+				}
+				if (map[it->target] != -1) {
+					loc[map[it->target]] = it->target;
+				}
+			} else if (it->target < 0) {
+				it->target = loc[-it->target - 1];
+			}
+		}
+		for (pending_gates::const_iterator it = held.begin(); it != held.end(); it++) {
+			if (strcmp(it->type, "SWP") != 0) {
+				write(*it);
+			}
+		}
+		pending_gates().swap(held);
+	}
+
+	void write(const QASMparser::gate& g) {
+		int layer = last_layer[g.target] + 1;
+		if (g.control != -1) {
+			layer = std::max(layer, last_layer[g.control] + 1);
+			last_layer[g.control] = layer;
+		}
+		last_layer[g.target] = layer;
+		depth = std::max(depth, layer + 1);
+		ngates++;
+		if (out != NULL) {
+			out->gate(g);
+		}
+	}
+};
+
+//Record the initial physical qubit of a logical qubit once it has been placed
+void place_qubit(int qubit, const int* locations, const std::vector<int>& origin, std::vector<int>& initial_locations,
+				 circuit_emitter& emitter) {
+	if (initial_locations[qubit] != -1 || locations[qubit] == -1) {
+		return;
+	}
+	initial_locations[qubit] = origin[locations[qubit]];
+	emitter.placed(qubit);
+}
+
+template<class Permutation>
+layer_result a_star_fixlayer(const Architecture& arch, MappingContext& context, int layer, int* map, int* loc) {
+
+	const int* const* dist = arch.dist;
+	int positions = arch.positions;
+	TRACE_SCOPE("a_star_fixlayer", "layer", layer);
+	int next_layer = context.getNextLayer(layer);
+	search_state<Permutation> search(arch, context);
+	search.stats.layer = layer;
+	std::chrono::steady_clock::time_point begin;
+	if(context.record_telemetry) {
+		begin = std::chrono::steady_clock::now();
+	}
+
+	node<Permutation> n;
+	n.cost_fixed = 0;
+	n.cost_heur = n.cost_heur2 = 0;
+	n.depth = 0;
+	n.nswaps = 0;
+	n.last_swap = -1;
+	n.done = 1;
+
+    const QASMparser::gate_list& v = context.layers[layer];
+    std::vector<int> considered_qubits;
+
+	//Find a mapping for all logical qubits in the CNOTs of the layer that are not yet mapped
+	for (QASMparser::gate_list::const_iterator it = v.begin(); it != v.end(); it++) {
+		const QASMparser::gate& g = *it;
+		if (g.control != -1) {
+			considered_qubits.push_back(g.control);
+			considered_qubits.push_back(g.target);
+			if(loc[g.control] == -1 && loc[g.target] == -1) {
+                std::set<edge> possible_edges;
+				for(std::set<edge>::const_iterator it = arch.graph.begin(); it != arch.graph.end(); it++) {
+					if(map[it->v1] == -1 && map[it->v2] == -1) {
+						possible_edges.insert(*it);
+					}
+				}
+				if(!possible_edges.empty()) {
+					edge e = *possible_edges.begin();
+					loc[g.control] = e.v1;
+					map[e.v1] = g.control;
+					loc[g.target] = e.v2;
+					map[e.v2] = g.target;
+				} else {
+                    throw mapping_error("no edge available");
+				}
+			} else if(loc[g.control] == -1) {
+				int min = 1000;
+				int min_pos = -1;
+				for(int i=0; i< positions; i++) {
+					if(map[i] == -1 && dist[i][loc[g.target]] < min) {
+						min = dist[i][loc[g.target]];
+						min_pos = i;
+					}
+				}
+				map[min_pos] = g.control;
+				loc[g.control] = min_pos;
+			} else if(loc[g.target] == -1) {
+				int min = 1000;
+				int min_pos = -1;
+				for(int i=0; i< positions; i++) {
+					if(map[i] == -1 && dist[loc[g.control]][i] < min) {
+						min = dist[loc[g.control]][i];
+						min_pos = i;
+					}
+				}
+				map[min_pos] = g.target;
+				loc[g.target] = min_pos;
+			}
+			n.cost_heur = std::max(n.cost_heur, dist[loc[g.control]][loc[g.target]]);
+		} else {
+			//Nothing to do here
+		}
+	}
+
+	if(n.cost_heur > 4) {
+		n.done = 0;
+	}
+	search.stats.cnots = considered_qubits.size() / 2;
+	search.stats.considered_qubits = considered_qubits.size();
+
+	std::vector<int> key;
+	layer_result result;
+	if(context.memo != NULL) {
+		memo_key(arch, context, layer, next_layer, map, loc, key);
+		if(context.memo->find(key, result)) {
+			search.stats.memo_hit = true;
+			record_telemetry(search, n, begin);
+			return result;
+		}
+	}
+
+	n.mapping.assign(map, loc, positions, context.nqubits);
+	n.id = 0;
+
+	search.nodes.push(n);
+	if(search.trace != NULL) {
+		search.trace->layer(layer, positions);
+		search.next_id = 1;
+		trace_node(search, n, SEARCH_TRACE_NO_PARENT, NULL, 0, true);
+	}
+	search.stats.peak_queue_size = 1;
+
+	std::vector<int> used(positions, 0);
+	//SWAPs of a node (in large-device mode, the candidate SWAPs: at most the degree of each considered qubit)
+	int max_degree = 1;
+	for(int i = 0; i < positions; i++) {
+		max_degree = std::max(max_degree, arch.table.adjacency_offsets[i + 1] - arch.table.adjacency_offsets[i]);
+	}
+	std::vector<edge> edges(considered_qubits.size() * max_degree);
+
+	//Perform an A* search to find the cheapest permutation
+	do {
+		while (!search.nodes.top().done) {
+			node<Permutation> n = search.nodes.top();
+			search.nodes.pop();
+			if(!first_expansion(search, n)) {
+				//in large-device mode, a permutation is expanded at most once
+				if(!widen_search(search) && search.nodes.empty()) {
+					record_telemetry(search, n, begin);
+					throw mapping_error("no mapping found for layer " + std::to_string(layer));
+				}
+				continue;
+			}
+
+			context.expanded_nodes++;
+			search.stats.nodes_expanded++;
+			if(context.max_nodes != 0 && context.expanded_nodes > context.max_nodes) {
+				record_telemetry(search, n, begin);
+				throw mapping_error("node budget exceeded");
+			}
+			if((context.expanded_nodes & 255) == 0 && std::chrono::steady_clock::now() > context.deadline) {
+				record_telemetry(search, n, begin);
+				throw mapping_error("time budget exceeded");
+			}
+
+			if(search.trace != NULL) {
+				search.trace->expanded(n.id);
+			}
+			expand(considered_qubits, edges.data(), used.data(), n, v, next_layer, search);
+			if(!widen_search(search) && search.nodes.empty()) {
+				record_telemetry(search, n, begin);
+				throw mapping_error("no mapping found for layer " + std::to_string(layer));
+			}
+			search.stats.peak_queue_size = std::max<unsigned long>(search.stats.peak_queue_size, search.nodes.size());
+		}
+	} while (continue_search(search, v));
+	context.peak_open_nodes = std::max(context.peak_open_nodes, search.stats.peak_queue_size);
+
+	const node<Permutation>& best = search.nodes.top();
+	record_telemetry(search, best, begin);
+	if(search.trace != NULL) {
+		search.trace->goal(best.id);
+	}
+	result.qubits.resize(positions);
+	result.locations.resize(context.nqubits);
+	best.mapping.copy_to(result.qubits.data(), result.locations.data(), positions, context.nqubits);
+	for (int i = best.last_swap; i != -1; i = search.swaps[i].previous) {
+		result.swaps.push_back(search.swaps[i].e);
+	}
+	std::reverse(result.swaps.begin(), result.swaps.end());
+	result.cost_heur = best.cost_heur;
+	if(context.memo != NULL) {
+		context.memo->insert(key, result);
+	}
+	return result;
+}
+
+typedef layer_result (*fixlayer_function)(const Architecture& arch, MappingContext& context, int layer, int* map, int* loc);
+
+//Select the search specialised for the size of the device and the circuit
+fixlayer_function select_fixlayer(int positions, int nqubits) {
+	if (positions > LARGE_DEVICE_POSITIONS) {
+		return a_star_fixlayer<sparse_permutation>;
+	}
+	if (positions <= packed_permutation<4, 1>::max_positions && nqubits <= packed_permutation<4, 1>::max_qubits) {
+		return a_star_fixlayer<packed_permutation<4, 1> >;
+	}
+	if (positions <= packed_permutation<5, 3>::max_positions && nqubits <= packed_permutation<5, 3>::max_qubits) {
+		return a_star_fixlayer<packed_permutation<5, 3> >;
+	}
+	if (positions <= packed_permutation<6, 6>::max_positions && nqubits <= packed_permutation<6, 6>::max_qubits) {
+		return a_star_fixlayer<packed_permutation<6, 6> >;
+	}
+	return a_star_fixlayer<dynamic_permutation>;
+}
+
+void MappingContext::map(const Architecture& arch, QASMwriter* out) {
+	TRACE_SCOPE("map");
+	const std::set<edge>& graph = arch.graph;
+	int positions = arch.positions;
+
+	//Initially, no physical qubit is occupied and no logical qubit is mapped to a physical one
+	std::vector<int> qubits(positions, -1);
+	std::vector<int> locations(nqubits, -1);
+
+#if USE_INITIAL_MAPPING
+	receive_layers(0);
+	for (QASMparser::gate_list::iterator it = layers[0].begin(); it != layers[0].end(); it++) {
+		QASMparser::gate g = *it;
+		if (g.control != -1) {
+			for(std::set<edge>::const_iterator it = graph.begin(); it != graph.end(); it++) {
+				if(qubits[it->v1] == -1 && qubits[it->v2] == -1) {
+					qubits[it->v1] = g.control;
+					qubits[it->v2] = g.target;
+					locations[g.control] = it->v1;
+					locations[g.target] = it->v2;
+					break;
+				}
+			}
+		}
+	}
+	for(unsigned int i=0; i<nqubits; i++) {
+		if(locations[i] == -1) {
+			int j=0;
+			while(qubits[j]!=-1){
+				j++;
+			}
+			locations[i] = j;
+			qubits[j] = i;
+		}
+	}
+#endif
+
+	if(out != NULL) {
+		out->header(positions);
+	}
+	circuit_emitter emitter(out, positions, nqubits);
+
+	//Initial physical qubit of the content currently located at a physical qubit (SWAPs move the content)
+	std::vector<int> origin(positions);
+	for (int i = 0; i < positions; i++) {
+		origin[i] = i;
+	}
+	initial_locations.assign(nqubits, -1);
+	nswaps = 0;
+	telemetry.clear();
+	expanded_nodes = 0;
+	peak_open_nodes = 0;
+	search_seconds = 0;
+#if USE_INITIAL_MAPPING
+	for (unsigned int i = 0; i < nqubits; i++) {
+		initial_locations[i] = locations[i];
+	}
+#endif
+
+	//Fix the mapping of each layer
+	fixlayer_function fixlayer = select_fixlayer(positions, nqubits);
+	for (unsigned int i = 0; receive_layers(i); i++) {
+		std::chrono::steady_clock::time_point search_begin = std::chrono::steady_clock::now();
+		layer_result result = fixlayer(arch, *this, i, qubits.data(), locations.data());
+		search_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - search_begin).count();
+
+		//Qubits are placed for this layer before its SWAPs move them, i.e. the held gates end before these SWAPs.
+		//The first layer does not require a permutation of the qubits, i.e. its qubits are placed after the SWAPs.
+		const int* placed = (i != 0) ? locations.data() : result.locations.data();
+		const int* placed_qubits = (i != 0) ? qubits.data() : result.qubits.data();
+		for (QASMparser::gate_list::const_iterator it = layers[i].begin();
+			 it != layers[i].end(); it++) {
+			if (it->control != -1) {
+				place_qubit(it->control, placed, origin, initial_locations, emitter);
+				place_qubit(it->target, placed, origin, initial_locations, emitter);
+			}
+		}
+		emitter.release(placed, placed_qubits, nqubits, positions);
+
+		locations.swap(result.locations);
+		qubits.swap(result.qubits);
+
+        std::vector<QASMparser::gate> h_gates = std::vector<QASMparser::gate>();
+
+		//The first layer does not require a permutation of the qubits
+		if (i != 0 && !result.swaps.empty()) {
+			TRACE_SCOPE("insert swaps", "swaps", result.swaps.size());
+			//Add the required SWAPs to the circuits
+			for (std::vector<edge>::iterator it = result.swaps.begin(); it != result.swaps.end(); it++) {
+				edge e = *it;
+				QASMparser::gate cnot;
+				QASMparser::gate h1;
+				QASMparser::gate h2;
+				if (graph.find(e) != graph.end()) {
+					cnot.control = e.v1;
+					cnot.target = e.v2;
+				} else {
+					cnot.control = e.v2;
+					cnot.target = e.v1;
+
+					int tmp = e.v1;
+					e.v1 = e.v2;
+					e.v2 = tmp;
+					if (graph.find(e) == graph.end()) {
+                        throw mapping_error("invalid SWAP gate");
+					}
+				}
+                strcpy(cnot.type, "CX");
+                strcpy(h1.type, "U3(pi/2,0,pi)");
+                strcpy(h2.type, "U3(pi/2,0,pi)");
+				h1.control = h2.control = -1;
+				h1.target = e.v1;
+				h2.target = e.v2;
+
+				emitter.emit(cnot);
+				emitter.emit(h1);
+				emitter.emit(h2);
+				emitter.emit(cnot);
+				emitter.emit(h1);
+				emitter.emit(h2);
+				emitter.emit(cnot);
+				emitter.swap(e.v1, e.v2);
+				std::swap(origin[e.v1], origin[e.v2]);
+				nswaps++;
+			}
+		}
+
+		//Add all gates of the layer to the circuit
+		for (QASMparser::gate_list::const_iterator it = layers[i].begin();
+			 it != layers[i].end(); it++) {
+			QASMparser::gate g = *it;
+			if (g.control == -1) {
+				//single qubit gate
+				if(locations[g.target] == -1) {
+					//handle the case that the qubit is not yet mapped. This happens if the qubit has not yet occurred in a CNOT gate
+					emitter.emit_unplaced(g);
+				} else {
+					//Add the gate to the circuit
+					g.target = locations[g.target];
+					emitter.emit(g);
+				}
+			} else {
+				//CNOT gate
+				g.target = locations[g.target];
+				g.control = locations[g.control];
+
+				edge e;
+				e.v1 = g.control;
+				e.v2 = g.target;
+
+				if (graph.find(e) == graph.end()) {
+					//flip the direction of the CNOT by inserting H gates
+					e.v1 = g.target;
+					e.v2 = g.control;
+					if (graph.find(e) == graph.end()) {
+                        throw mapping_error("invalid CNOT: " + std::to_string(e.v1) + " - " + std::to_string(e.v2));
+					}
+					QASMparser::gate h;
+					h.control = -1;
+					strcpy(h.type, "U3(pi/2,0,pi)");
+					h.target = g.target;
+					emitter.emit(h);
+
+					h_gates.push_back(h);
+					h.target = g.control;
+					emitter.emit(h);
+
+					h_gates.push_back(h);
+					int tmp = g.target;
+					g.target = g.control;
+					g.control = tmp;
+				}
+				emitter.emit(g);
+			}
+		}
+		if (h_gates.size() != 0) {
+			if (result.cost_heur == 0) {
+                throw mapping_error("invalid heuristic cost");
+			}
+
+			for (std::vector<QASMparser::gate>::iterator it = h_gates.begin();
+				 it != h_gates.end(); it++) {
+				emitter.emit(*it);
+			}
+		}
+
+		//The look-ahead only considers subsequent layers, hence this one is no longer needed
+		QASMparser::gate_list().swap(layers[i]);
+	}
+
+	//Qubits that occur only in single qubit gates can be mapped to an arbitrary free physical qubit
+	TRACE_SCOPE("place unmapped qubits");
+	for (unsigned int i = 0; i < nqubits; i++) {
+		if (locations[i] == -1 && emitter.waiting[i]) {
+			int loc = 0;
+			while (qubits[loc] != -1) {
+				loc++;
+			}
+			qubits[loc] = i;
+			locations[i] = loc;
+			place_qubit(i, locations.data(), origin, initial_locations, emitter);
+		}
+	}
+	emitter.release(locations.data(), qubits.data(), nqubits, positions);
+
+	mapped_ngates = emitter.ngates;
+	mapped_depth = emitter.depth;
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "QASMparser.h"
+#include "QASMwriter.h"
+#include "architecture.h"
+#include "bounded_queue.h"
+#include "dist_table.h"
+#include "search_trace.h"
+
+#ifndef MAPPER_H
+#define MAPPER_H
+
+/**
+ * Thrown if a circuit cannot be mapped.
+ */
+class mapping_error : public std::runtime_error {
+public:
+	explicit mapping_error(const std::string& what) : std::runtime_error(what) {
+	}
+};
+
+/**
+ * Compile time options of the search, which determine the mapped circuits together with SWAP_COST and FLIP_COST.
+ */
+extern const char* const search_configuration;
+
+/**
+ * Coupling graph, adjacency index and distance table of a device. An Architecture is immutable once created and
+ * may be shared by any number of mappings running concurrently.
+ */
+class Architecture {
+public:
+	/**
+	 * Create the architecture selected by spec (see build_architecture()) for a circuit with nqubits logical qubits.
+	 * If dist_cache is not NULL, the distance table is taken from that directory (see load_dist_table()).
+	 * Returns NULL and describes the problem in error if the architecture cannot be built.
+	 */
+	static std::shared_ptr<const Architecture> create(const std::string& spec, unsigned int nqubits,
+													  const char* dist_cache, std::string& error);
+
+	std::string name;
+	unsigned long id = 0; // unique among all architectures created by the process
+	std::set<edge> graph;
+	int positions = 0;
+	dist_table table;
+	const int* const* dist = NULL;
+};
+
+//Mapping determined for a layer
+struct layer_result {
+	std::vector<int> qubits;
+	std::vector<int> locations;
+	std::vector<edge> swaps;
+	int cost_heur;
+};
+
+/**
+ * Results of the A* search of single layers, shared by all mappings of a process (e.g. the requests of the
+ * server). The search of a layer only depends on the architecture, the current mapping and the CNOTs of the layer
+ * and of the next layer containing a CNOT (look-ahead), hence recurring situations are looked up instead of
+ * searched again. Holds at most capacity results; the least recently used ones are dropped. Thread safe.
+ */
+class layer_memo {
+public:
+	explicit layer_memo(size_t capacity) : capacity_(capacity) {
+	}
+
+	bool find(const std::vector<int>& key, layer_result& result);
+	void insert(const std::vector<int>& key, const layer_result& result);
+
+private:
+	struct entry {
+		std::vector<int> key;
+		layer_result result;
+	};
+
+	size_t capacity_;
+	std::mutex mutex_;
+	std::list<entry> entries_; // most recently used first
+	std::unordered_map<uint64_t, std::list<entry>::iterator> index_;
+};
+
+//Statistics of the search of a layer, see MappingContext::record_telemetry
+struct layer_telemetry {
+	unsigned int layer;
+	int cnots;
+	int considered_qubits;
+	unsigned long nodes_generated;
+	unsigned long nodes_expanded;
+	unsigned long duplicates_rejected; // generated nodes dropped because an equivalent node is queued at lower cost
+	unsigned long queue_replacements;  // see unique_priority_queue::replacements()
+	unsigned long peak_queue_size;
+	double seconds;
+	// cost of the node found (those of the last node expanded if the search has been aborted)
+	int cost_fixed;
+	int cost_heur;
+	int cost_heur2;
+	bool memo_hit;                     // the result was taken from the layer_memo, i.e. there was no search
+};
+
+//A SWAP leading to a search node, linked to the previous SWAP of that node (-1 if there is none)
+struct swap_step {
+	int previous;
+	edge e;
+};
+
+typedef std::vector<swap_step, counting_allocator<swap_step, memory_category::swap_log> > swap_history;
+
+/**
+ * State of the mapping of one circuit. Every job uses its own context, hence several circuits can be mapped
+ * concurrently against the same Architecture.
+ */
+class MappingContext {
+public:
+	std::vector<QASMparser::gate_list> layers;
+	// if not NULL, layers are received from a parser running concurrently (see QASMparser::setLayerQueue())
+	bounded_queue<QASMparser::gate_list>* layer_stream = NULL;
+	unsigned int nqubits = 0;
+	unsigned long ngates = 0;
+	std::vector<std::string> includes; // files included by the parsed circuit
+
+	// budgets of the search, map() throws mapping_error if one is exceeded
+	unsigned long max_nodes = 0; // maximal number of search nodes expanded for the circuit, 0 for no limit
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	layer_memo* memo = NULL;     // if not NULL, results of the search of single layers are shared via memo
+	bool record_telemetry = false; // append a record for the search of each layer to telemetry
+	search_trace_writer* search_trace = NULL; // if not NULL, every node of the search is recorded
+
+	// results of map()
+	unsigned long mapped_ngates = 0;
+	int mapped_depth = 0;
+	unsigned long nswaps = 0;           // SWAPs inserted
+	std::vector<int> initial_locations; // initial physical qubit of each logical qubit
+	unsigned long expanded_nodes = 0;   // search nodes expanded
+	unsigned long peak_open_nodes = 0;  // maximal number of nodes in the open list of the search of a layer
+	double search_seconds = 0;          // time spent in the search (the remainder of map() emits the circuit)
+	std::vector<layer_telemetry> telemetry;
+
+	// scratch space of the search, reused for all layers
+	swap_history swap_log;
+
+	/**
+	 * Map the circuit to arch and write the mapped circuit to out (if not NULL). Throws mapping_error if the circuit
+	 * cannot be mapped.
+	 */
+	void map(const Architecture& arch, QASMwriter* out);
+
+	/**
+	 * In streaming mode, receive layers from the parser until the given layer and the next layer containing a CNOT
+	 * (required for the look-ahead) are available. Returns true iff the given layer exists.
+	 */
+	bool receive_layers(unsigned int layer);
+
+	/**
+	 * Index of the next layer after the given one that contains a CNOT, (unsigned int) -1 if there is none.
+	 */
+	unsigned int getNextLayer(unsigned int layer) const;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "memory_stats.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+
+std::atomic<size_t> memory_current[(int) memory_category::count];
+std::atomic<size_t> memory_peak[(int) memory_category::count];
+
+static const char* const memory_category_names[] = {"layers", "expressions", "compound_gates", "dist_table",
+													"search_queue", "search_set", "swap_log", "output"};
+static_assert(sizeof(memory_category_names) / sizeof(memory_category_names[0]) == (size_t) memory_category::count,
+			  "a memory_category has no name");
+
+const char* memory_category_name(memory_category c) {
+	return memory_category_names[(int) c];
+}
+
+std::string memory_report(const memory_usage& usage) {
+	std::string report = "Memory (bytes):\n";
+	char line[128];
+	snprintf(line, sizeof(line), "  %-16s %14s %14s\n", "", "peak", "current");
+	report += line;
+	size_t peak = 0;
+	size_t current = 0;
+	for (int i = 0; i < (int) memory_category::count; i++) {
+		snprintf(line, sizeof(line), "  %-16s %14zu %14zu\n", memory_category_names[i], usage.peak[i], usage.current[i]);
+		report += line;
+		peak += usage.peak[i];
+		current += usage.current[i];
+	}
+	//the categories peak at different times, hence the sum of the peaks is an upper bound
+	snprintf(line, sizeof(line), "  %-16s %14zu %14zu\n  %-16s %14ld\n", "total", peak, current, "peak RSS (KiB)",
+			 usage.peak_rss_kb);
+	report += line;
+	return report;
+}
+
+memory_usage memory_snapshot() {
+	memory_usage usage;
+	for (int i = 0; i < (int) memory_category::count; i++) {
+		usage.current[i] = memory_current[i].load(std::memory_order_relaxed);
+		usage.peak[i] = memory_peak[i].load(std::memory_order_relaxed);
+	}
+	usage.peak_rss_kb = peak_rss_kb();
+	return usage;
+}
+
+void memory_reset_peaks() {
+	for (int i = 0; i < (int) memory_category::count; i++) {
+		memory_peak[i].store(memory_current[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+	//Linux only, otherwise peak_rss_kb() reports the peak of the whole run
+	FILE* f = fopen("/proc/self/clear_refs", "w");
+	if (f != NULL) {
+		fputs("5", f);
+		fclose(f);
+	}
+}
+
+long peak_rss_kb() {
+	FILE* f = fopen("/proc/self/status", "r");
+	if (f != NULL) {
+		char line[256];
+		long kb = -1;
+		while (fgets(line, sizeof(line), f) != NULL) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				kb = strtol(line + 6, NULL, 10);
+			}
+		}
+		fclose(f);
+		if (kb >= 0) {
+			return kb;
+		}
+	}
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return -1;
+	}
+	return usage.ru_maxrss;
+}
@@ -0,0 +1,155 @@
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+/*
+ * Accounting of the memory held by the main data structures of the mapper, per category and process wide (with
+ * several threads, the figures are those of all circuits mapped concurrently). Containers count their allocations
+ * with counting_allocator, other owners of memory (e.g. arenas) charge it with memory_charge.
+ */
+enum class memory_category {
+	layers,         // gates of the circuit, from parsing until their layer is mapped
+	expressions,    // Expr trees of the parser (ExprArena)
+	compound_gates, // gate declarations of the parser and of shared preludes
+	dist_table,
+	search_queue,   // nodes in the priority queue of the search
+	search_set,     // nodes in the membership set of the search
+	swap_log,       // SWAPs of all generated nodes (MappingContext::swap_log)
+	output,         // output buffer, mapped circuit kept in memory and gates waiting for their qubit to be placed
+	count
+};
+
+const char* memory_category_name(memory_category c);
+
+extern std::atomic<size_t> memory_current[(int) memory_category::count];
+extern std::atomic<size_t> memory_peak[(int) memory_category::count];
+
+inline void memory_allocate(memory_category c, size_t bytes) {
+	size_t current = memory_current[(int) c].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	size_t peak = memory_peak[(int) c].load(std::memory_order_relaxed);
+	while (current > peak && !memory_peak[(int) c].compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+	}
+}
+
+inline void memory_release(memory_category c, size_t bytes) {
+	memory_current[(int) c].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+struct memory_usage {
+	size_t current[(int) memory_category::count];
+	size_t peak[(int) memory_category::count];
+	long peak_rss_kb; // of the process, -1 if unknown
+};
+
+/**
+ * Current and peak bytes of all categories and the peak RSS of the process.
+ */
+memory_usage memory_snapshot();
+
+/**
+ * Start new peaks at the current values (and the peak RSS at the current RSS where supported, i.e. on Linux).
+ */
+void memory_reset_peaks();
+
+/**
+ * Table of the peak and current bytes of all categories and of the peak RSS.
+ */
+std::string memory_report(const memory_usage& usage);
+
+/**
+ * Peak resident set size of the process in KiB since the start or the last memory_reset_peaks().
+ */
+long peak_rss_kb();
+
+/**
+ * Allocator adaptor of std::allocator charging all allocations to a category.
+ */
+template<class T, memory_category C>
+class counting_allocator : public std::allocator<T> {
+public:
+	typedef T value_type;
+
+	template<class U>
+	struct rebind {
+		typedef counting_allocator<U, C> other;
+	};
+
+	counting_allocator() = default;
+
+	template<class U>
+	counting_allocator(const counting_allocator<U, C>&) {
+	}
+
+	T* allocate(size_t n) {
+		memory_allocate(C, n * sizeof(T));
+		return std::allocator<T>::allocate(n);
+	}
+
+	void deallocate(T* p, size_t n) {
+		memory_release(C, n * sizeof(T));
+		std::allocator<T>::deallocate(p, n);
+	}
+};
+
+template<class T, class U, memory_category C>
+bool operator==(const counting_allocator<T, C>&, const counting_allocator<U, C>&) {
+	return true;
+}
+
+template<class T, class U, memory_category C>
+bool operator!=(const counting_allocator<T, C>&, const counting_allocator<U, C>&) {
+	return false;
+}
+
+/**
+ * Bytes charged to a category by their owner and released with it. Moving the owner moves the charge.
+ */
+class memory_charge {
+public:
+	explicit memory_charge(memory_category c) : category_(c), bytes_(0) {
+	}
+
+	memory_charge(memory_charge&& other) : category_(other.category_), bytes_(other.bytes_) {
+		other.bytes_ = 0;
+	}
+
+	memory_charge& operator=(memory_charge&& other) {
+		memory_release(category_, bytes_);
+		category_ = other.category_;
+		bytes_ = other.bytes_;
+		other.bytes_ = 0;
+		return *this;
+	}
+
+	memory_charge(const memory_charge&) = delete;
+	memory_charge& operator=(const memory_charge&) = delete;
+
+	~memory_charge() {
+		memory_release(category_, bytes_);
+	}
+
+	void add(size_t bytes) {
+		memory_allocate(category_, bytes);
+		bytes_ += bytes;
+	}
+
+	// charge exactly the given amount, e.g. the capacity of a growing buffer
+	void set(size_t bytes) {
+		if (bytes > bytes_) {
+			add(bytes - bytes_);
+		} else {
+			memory_release(category_, bytes_ - bytes);
+			bytes_ = bytes;
+		}
+	}
+
+private:
+	memory_category category_;
+	size_t bytes_;
+};
+
+#endif
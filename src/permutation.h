@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifndef PERMUTATION_H
+#define PERMUTATION_H
+
+/*
+ * Assignments of logical qubits to physical qubits (locations) as stored in the search nodes. All variants provide
+ *   qubit(l)       logical qubit at location l (-1 if the location is empty)
+ *   location(q)    location of logical qubit q (-1 if q is not mapped yet)
+ *   swap(l1, l2)   exchange the contents of two locations
+ * and a strict total order. The packed and dynamic variants are ordered lexicographically by qubit(0), qubit(1), ...
+ */
+
+/**
+ * Permutation packed into Words machine words with Bits bits per location, for devices with at most
+ * max_positions physical qubits and circuits with at most max_qubits logical qubits. A slot holds qubit+1 (0 for an
+ * empty location) and location 0 occupies the most significant bits, so comparing the words in order compares the
+ * permutations. The permutation is trivially copyable.
+ */
+template<int Bits, int Words>
+class packed_permutation
+{
+public:
+    static const int max_positions = 64 / Bits * Words;
+    static const int max_qubits = (1 << Bits) - 1;
+
+    void assign(const int* qubits, const int* locations, int positions, int nqubits) {
+        memset(words_, 0, sizeof(words_));
+        for(int l = 0; l < positions; l++) {
+            set(l, qubits[l]);
+        }
+        for(int q = 0; q < nqubits; q++) {
+            locations_[q] = locations[q];
+        }
+    }
+
+    void copy_to(int* qubits, int* locations, int positions, int nqubits) const {
+        for(int l = 0; l < positions; l++) {
+            qubits[l] = qubit(l);
+        }
+        for(int q = 0; q < nqubits; q++) {
+            locations[q] = locations_[q];
+        }
+    }
+
+    int qubit(int l) const {
+        return (int) ((words_[l / slots] >> shift(l)) & mask) - 1;
+    }
+
+    int location(int q) const {
+        return locations_[q];
+    }
+
+    void swap(int l1, int l2) {
+        int q1 = qubit(l1);
+        int q2 = qubit(l2);
+        set(l1, q2);
+        set(l2, q1);
+        if(q1 != -1) {
+            locations_[q1] = l2;
+        }
+        if(q2 != -1) {
+            locations_[q2] = l1;
+        }
+    }
+
+    bool operator<(const packed_permutation& other) const {
+        for(int i = 0; i < Words; i++) {
+            if(words_[i] != other.words_[i]) {
+                return words_[i] < other.words_[i];
+            }
+        }
+        return false;
+    }
+
+private:
+    static const int slots = 64 / Bits;
+    static const uint64_t mask = (1ull << Bits) - 1;
+
+    static int shift(int l) {
+        return (slots - 1 - l % slots) * Bits;
+    }
+
+    void set(int l, int q) {
+        uint64_t& w = words_[l / slots];
+        w = (w & ~(mask << shift(l))) | ((uint64_t) (q + 1) << shift(l));
+    }
+
+    uint64_t words_[Words];
+    int8_t locations_[max_qubits];
+};
+
+/**
+ * Permutation of arbitrary size stored on the heap.
+ */
+class dynamic_permutation
+{
+public:
+    void assign(const int* qubits, const int* locations, int positions, int nqubits) {
+        qubits_.assign(qubits, qubits + positions);
+        locations_.assign(locations, locations + nqubits);
+    }
+
+    void copy_to(int* qubits, int* locations, int positions, int nqubits) const {
+        memcpy(qubits, qubits_.data(), sizeof(int) * positions);
+        memcpy(locations, locations_.data(), sizeof(int) * nqubits);
+    }
+
+    int qubit(int l) const {
+        return qubits_[l];
+    }
+
+    int location(int q) const {
+        return locations_[q];
+    }
+
+    void swap(int l1, int l2) {
+        int q1 = qubits_[l1];
+        int q2 = qubits_[l2];
+        qubits_[l1] = q2;
+        qubits_[l2] = q1;
+        if(q1 != -1) {
+            locations_[q1] = l2;
+        }
+        if(q2 != -1) {
+            locations_[q2] = l1;
+        }
+    }
+
+    bool operator<(const dynamic_permutation& other) const {
+        return qubits_ < other.qubits_;
+    }
+
+private:
+    std::vector<int> qubits_;
+    std::vector<int> locations_;
+};
+
+/**
+ * Permutation of a large device stored as the locations whose content differs from a shared base permutation (the
+ * root of a search, see rebase()), i.e. a node only holds the few locations its SWAPs changed. Permutations derived
+ * from different bases must not be compared. A hash of the whole permutation is maintained incrementally; it is
+ * XOR-combined over the locations, hence a SWAP updates it in constant time.
+ */
+class sparse_permutation
+{
+public:
+    void assign(const int* qubits, const int* locations, int positions, int nqubits) {
+        std::shared_ptr<base> b = std::make_shared<base>();
+        b->qubits.assign(qubits, qubits + positions);
+        b->locations.assign(locations, locations + nqubits);
+        base_ = b;
+        changes_.clear();
+        hash_ = 0;
+        for(int l = 0; l < positions; l++) {
+            hash_ ^= slot_hash(l, qubits[l]);
+        }
+    }
+
+    void copy_to(int* qubits, int* locations, int positions, int nqubits) const {
+        memcpy(qubits, base_->qubits.data(), sizeof(int) * positions);
+        memcpy(locations, base_->locations.data(), sizeof(int) * nqubits);
+        for(const change& c : changes_) {
+            qubits[c.location] = c.qubit;
+            if(c.qubit != -1) {
+                locations[c.qubit] = c.location;
+            }
+        }
+    }
+
+    int qubit(int l) const {
+        std::vector<change>::const_iterator it = find(l);
+        if(it != changes_.end() && it->location == l) {
+            return it->qubit;
+        }
+        return base_->qubits[l];
+    }
+
+    int location(int q) const {
+        //a qubit that has been moved is the new content of a changed location
+        for(const change& c : changes_) {
+            if(c.qubit == q) {
+                return c.location;
+            }
+        }
+        return base_->locations[q];
+    }
+
+    void swap(int l1, int l2) {
+        int q1 = qubit(l1);
+        int q2 = qubit(l2);
+        set(l1, q2);
+        set(l2, q1);
+        hash_ ^= slot_hash(l1, q1) ^ slot_hash(l1, q2) ^ slot_hash(l2, q2) ^ slot_hash(l2, q1);
+    }
+
+    //make the permutation the base of its copies, e.g. when a search continues from it (the copies of the old base
+    //neither compare to those of the new one nor do they share its memory)
+    void rebase() {
+        std::shared_ptr<base> b = std::make_shared<base>(*base_);
+        for(const change& c : changes_) {
+            b->qubits[c.location] = c.qubit;
+            if(c.qubit != -1) {
+                b->locations[c.qubit] = c.location;
+            }
+        }
+        base_ = b;
+        changes_.clear();
+    }
+
+    uint64_t hash() const {
+        return hash_;
+    }
+
+    bool operator==(const sparse_permutation& other) const {
+        return hash_ == other.hash_ && changes_ == other.changes_;
+    }
+
+    bool operator<(const sparse_permutation& other) const {
+        return changes_ < other.changes_;
+    }
+
+private:
+    struct base {
+        std::vector<int> qubits;
+        std::vector<int> locations;
+    };
+
+    struct change {
+        int location;
+        int qubit;
+
+        bool operator==(const change& other) const {
+            return location == other.location && qubit == other.qubit;
+        }
+
+        bool operator<(const change& other) const {
+            return location < other.location || (location == other.location && qubit < other.qubit);
+        }
+    };
+
+    static uint64_t slot_hash(int l, int q) {
+        //splitmix64 finaliser of the pair
+        uint64_t z = ((uint64_t) (uint32_t) l << 32 | (uint32_t) q) + 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::vector<change>::const_iterator find(int l) const {
+        return std::lower_bound(changes_.begin(), changes_.end(), change{l, -2});
+    }
+
+    //changes_ is sorted by location and only holds locations differing from the base, hence it is canonical
+    void set(int l, int q) {
+        std::vector<change>::iterator it = changes_.begin() + (find(l) - changes_.begin());
+        bool changed = it != changes_.end() && it->location == l;
+        if(q == base_->qubits[l]) {
+            if(changed) {
+                changes_.erase(it);
+            }
+        } else if(changed) {
+            it->qubit = q;
+        } else {
+            changes_.insert(it, change{l, q});
+        }
+    }
+
+    std::shared_ptr<const base> base_;
+    std::vector<change> changes_;
+    uint64_t hash_ = 0;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "profile.h"
+
+#if PROFILE
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+
+static const char* const profile_names[] = {"expand_node", "search_node", "heuristic", "look_ahead", "queue_push",
+											"queue_pop", "scanner_token"};
+static_assert(sizeof(profile_names) / sizeof(profile_names[0]) == (size_t) profile_id::count,
+			  "a profile_id has no name");
+
+static std::mutex threads_mutex;
+//The counters outlive their thread, hence the summary includes finished threads, too
+static std::vector<std::shared_ptr<profile_counters> > threads;
+
+//Reference points to convert cycles into seconds
+static uint64_t origin_cycles = profile_cycles();
+static std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+profile_counters& profile_local() {
+	thread_local std::shared_ptr<profile_counters> counters;
+	if (!counters) {
+		counters = std::make_shared<profile_counters>();
+		for (int i = 0; i < (int) profile_id::count; i++) {
+			counters->calls[i] = 0;
+			counters->cycles[i] = 0;
+		}
+		std::lock_guard<std::mutex> lock(threads_mutex);
+		threads.push_back(counters);
+	}
+	return *counters;
+}
+
+void profile_report() {
+	uint64_t calls[(int) profile_id::count] = {};
+	uint64_t cycles[(int) profile_id::count] = {};
+	size_t nthreads;
+	{
+		std::lock_guard<std::mutex> lock(threads_mutex);
+		nthreads = threads.size();
+		for (const std::shared_ptr<profile_counters>& t : threads) {
+			for (int i = 0; i < (int) profile_id::count; i++) {
+				calls[i] += t->calls[i].load(std::memory_order_relaxed);
+				cycles[i] += t->cycles[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+	uint64_t elapsed_cycles = profile_cycles() - origin_cycles;
+	double seconds_per_cycle = elapsed_cycles > 0 ? elapsed / elapsed_cycles : 0;
+
+	fprintf(stderr, "\nProfile of %zu thread(s), %.3f s:\n", nthreads, elapsed);
+	fprintf(stderr, "  %-16s %14s %16s %12s %12s\n", "", "calls", "cycles", "cycles/call", "seconds");
+	for (int i = 0; i < (int) profile_id::count; i++) {
+		if (cycles[i] == 0) {
+			fprintf(stderr, "  %-16s %14llu\n", profile_names[i], (unsigned long long) calls[i]);
+		} else {
+			fprintf(stderr, "  %-16s %14llu %16llu %12.1f %12.6f\n", profile_names[i], (unsigned long long) calls[i],
+					(unsigned long long) cycles[i], calls[i] > 0 ? (double) cycles[i] / calls[i] : 0.0,
+					cycles[i] * seconds_per_cycle);
+		}
+	}
+}
+
+void profile_start() {
+	//SIGUSR1 is blocked in all threads (which inherit the mask) and handled by a thread of its own, hence the
+	//summary is not written from a signal handler
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	std::thread([signals]() {
+		for (;;) {
+			int signal;
+			if (sigwait(&signals, &signal) == 0) {
+				profile_report();
+			}
+		}
+	}).detach();
+	atexit(profile_report);
+}
+
+#endif
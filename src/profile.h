@@ -0,0 +1,105 @@
+#include <cstdint>
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// 1 to count and time the hot paths of the search and the parser (e.g. cmake -DPROFILE=ON)
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+/**
+ * Hot-path profiling: per-thread event counters and cycle counting (RDTSC) scoped timers. Without PROFILE, the
+ * macros expand to nothing. Otherwise, a summary table of all threads is written to stderr when the program exits
+ * and whenever it receives SIGUSR1 (see profile_start()).
+ */
+enum class profile_id {
+	expand_node,      // calls of expand_node()
+	search_node,      // nodes generated by expand_node()
+	heuristic,        // heuristic cost of the current layer
+	look_ahead,       // heuristic cost of the next layer
+	queue_push,
+	queue_pop,
+	scanner_token,    // tokens read by the QASM scanner
+	count
+};
+
+#if PROFILE
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+struct profile_counters {
+	// only written by the owning thread, relaxed atomics merely allow the summary to read them concurrently
+	std::atomic<uint64_t> calls[(int) profile_id::count];
+	std::atomic<uint64_t> cycles[(int) profile_id::count];
+};
+
+/**
+ * Counters of the calling thread, registered for the summary on first use.
+ */
+profile_counters& profile_local();
+
+inline uint64_t profile_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline void profile_add(std::atomic<uint64_t>& counter, uint64_t n) {
+	counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+class profile_timer {
+public:
+	explicit profile_timer(profile_id id) : id_((int) id), begin_(profile_cycles()) {}
+
+	~profile_timer() {
+		profile_counters& local = profile_local();
+		profile_add(local.cycles[id_], profile_cycles() - begin_);
+		profile_add(local.calls[id_], 1);
+	}
+
+	profile_timer(const profile_timer&) = delete;
+	profile_timer& operator=(const profile_timer&) = delete;
+
+private:
+	int id_;
+	uint64_t begin_;
+};
+
+/**
+ * Write the summary at exit and on SIGUSR1. Must be called before any other thread is started.
+ */
+void profile_start();
+
+/**
+ * Write the summary table of all threads (finished ones included) to stderr.
+ */
+void profile_report();
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// count an event, e.g. PROFILE_COUNT(search_node)
+#define PROFILE_COUNT(id) profile_add(profile_local().calls[(int) profile_id::id], 1)
+// count and time the remainder of the enclosing block, e.g. PROFILE_TIMER(queue_push)
+#define PROFILE_TIMER(id) profile_timer PROFILE_CONCAT(profile_timer_, __LINE__)(profile_id::id)
+
+#else
+
+inline void profile_start() {}
+inline void profile_report() {}
+
+#define PROFILE_COUNT(id)
+#define PROFILE_TIMER(id)
+
+#endif
+
+#endif
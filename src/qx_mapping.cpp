@@ -0,0 +1,463 @@
+#include "qx_mapping.h"
+#include "binary_circuit.h"
+#include "json.h"
+#include "result_cache.h"
+#include "trace.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+
+#define STREAM_QUEUE_CAPACITY 1024 // number of layers the parser may run ahead of the mapping in streaming mode
+
+//Specs without an explicit size depend on the number of qubits of the circuit
+static std::string architecture_key(const std::string& spec, unsigned int nqubits) {
+	if (spec == "linear" || spec == "ring" || spec == "grid" || spec == "heavyhex") {
+		return spec + ":" + std::to_string(nqubits);
+	}
+	return spec;
+}
+
+std::shared_ptr<const Architecture> architecture_cache::get(const std::string& spec, unsigned int nqubits,
+															const std::string& dist_cache, std::string& error) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::string key = architecture_key(spec, nqubits);
+	std::map<std::string, std::shared_ptr<const Architecture> >::iterator it = architectures_.find(key);
+	if (it != architectures_.end()) {
+		return it->second;
+	}
+	std::shared_ptr<const Architecture> arch = Architecture::create(spec, nqubits,
+																	dist_cache.empty() ? NULL : dist_cache.c_str(),
+																	error);
+	if (arch) {
+		architectures_[key] = arch;
+	}
+	return arch;
+}
+
+bool parse_circuit(const mapping_job& job, MappingContext& context, std::string& error) {
+	try {
+		if (!job.input.empty() && is_binary_circuit(job.input)) {
+			if (!read_binary_circuit(job.input, context.layers, context.nqubits, context.ngates)) {
+				error = "cannot read binary circuit " + job.input;
+				return false;
+			}
+			return true;
+		}
+
+		std::istringstream source(job.source);
+		std::unique_ptr<QASMparser> parser(job.input.empty() ? new QASMparser(source) : new QASMparser(job.input));
+		parser->Parse();
+		context.layers = parser->takeLayers();
+		context.nqubits = parser->getNqubits();
+		context.ngates = parser->getNgates();
+		context.includes = parser->getIncludes();
+	} catch (const std::exception& e) {
+		error = e.what();
+		return false;
+	}
+
+	if (!job.save_binary.empty() && !write_binary_circuit(job.save_binary, context.layers, context.nqubits)) {
+		error = "cannot write binary circuit " + job.save_binary;
+		return false;
+	}
+	return true;
+}
+
+bool map_circuit(const Architecture& arch, MappingContext& context, QASMwriter* out, std::string& error) {
+	if ((int) context.nqubits > arch.positions) {
+		error = "more logical qubits than physical ones";
+		return false;
+	}
+	try {
+		context.map(arch, out);
+	} catch (const std::exception& e) {
+		error = e.what();
+		return false;
+	}
+	return true;
+}
+
+//The QASM source or binary circuit of a job as it is
+static bool read_input(const mapping_job& job, std::string& text) {
+	if (job.input.empty()) {
+		text = job.source;
+		return true;
+	}
+	std::ifstream in(job.input, std::ifstream::in | std::ifstream::binary);
+	if (!in.good()) {
+		return false;
+	}
+	std::stringstream ss;
+	ss << in.rdbuf();
+	text = ss.str();
+	return true;
+}
+
+//Emit a mapped circuit that has been determined before (see result_cache)
+static mapping_result emit_cached(const mapping_job& job, const mapping_options& options, mapping_result& result) {
+	result.cached = true;
+	if (!job.output.empty()) {
+		QASMwriter out(job.output);
+		out.write(result.qasm.data(), result.qasm.size());
+		out.flush();
+		if (!out.good()) {
+			result.ok = false;
+			result.error = "cannot write the mapped circuit to " + job.output;
+		}
+	}
+	if (!job.output.empty() || !options.keep_qasm) {
+		std::string().swap(result.qasm);
+	}
+	return result;
+}
+
+mapping_result map_job(const mapping_job& job, const mapping_options& options, architecture_cache& architectures,
+					   layer_memo* memo) {
+	mapping_result result;
+	result.name = !job.name.empty() ? job.name : job.input.substr(job.input.find_last_of('/') + 1);
+	TRACE_SCOPE("map_job", "circuit", result.name);
+
+	MappingContext context;
+	context.max_nodes = options.max_nodes;
+	context.memo = memo;
+	context.record_telemetry = options.telemetry;
+	bool stream = options.stream && job.save_binary.empty() && (job.input.empty() || !is_binary_circuit(job.input));
+
+	std::unique_ptr<result_cache> cache;
+	uint64_t source_key = 0;
+	uint64_t key = 0;
+	std::string input;
+	if (!options.result_cache.empty() && job.save_binary.empty() && options.search_trace.empty()
+		&& read_input(job, input)) {
+		cache.reset(new result_cache(options.result_cache, options.result_cache_size));
+		source_key = result_cache::source_key(input, options.arch);
+		if (cache->find_source(source_key, key) && cache->find(key, result)) {
+			return emit_cached(job, options, result);
+		}
+		std::string().swap(input);
+		//the gate stream is hashed before it is mapped
+		stream = false;
+	}
+	std::istringstream source(job.source);
+	std::unique_ptr<QASMparser> parser;
+	bounded_queue<QASMparser::gate_list> layer_stream(STREAM_QUEUE_CAPACITY);
+	std::thread producer;
+	std::string parse_error;
+
+	if (stream) {
+		//Parse in a separate thread and start mapping as soon as the first layers are complete
+		try {
+			parser.reset(job.input.empty() ? new QASMparser(source) : new QASMparser(job.input));
+		} catch (const std::exception& e) {
+			result.error = e.what();
+			return result;
+		}
+		parser->setLayerQueue(&layer_stream);
+		context.layer_stream = &layer_stream;
+		QASMparser* p = parser.get();
+		producer = std::thread([p, &layer_stream, &parse_error]() {
+			trace_thread_name("parser");
+			try {
+				p->Parse();
+			} catch (const std::exception& e) {
+				parse_error = e.what();
+			}
+			layer_stream.close();
+		});
+		//all qregs are declared once the first layer has been handed over
+		context.receive_layers(0);
+		context.nqubits = parser->getNqubits();
+	} else if (!parse_circuit(job, context, result.error)) {
+		return result;
+	}
+
+	std::shared_ptr<const Architecture> arch = architectures.get(options.arch, context.nqubits, options.dist_cache,
+																 result.error);
+	bool ok = (bool) arch;
+	if (ok && cache) {
+		key = result_cache::circuit_key(context, *arch);
+		if (cache->find(key, result)) {
+			cache->store_source(source_key, key, context.includes);
+			return emit_cached(job, options, result);
+		}
+	}
+
+	std::unique_ptr<QASMwriter> out;
+	if (ok && cache) {
+		//the mapped circuit is stored in the cache before it is emitted
+		out.reset(new QASMwriter(&result.qasm));
+	} else if (ok && !job.output.empty()) {
+		out.reset(new QASMwriter(job.output));
+		if (!out->good()) {
+			result.error = "cannot open " + job.output;
+			ok = false;
+		}
+	} else if (ok && options.keep_qasm) {
+		out.reset(new QASMwriter(&result.qasm));
+	}
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	if (options.max_seconds > 0) {
+		context.deadline = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(options.max_seconds));
+	}
+	std::unique_ptr<search_trace_writer> search_trace;
+	if (ok && !options.search_trace.empty()) {
+		search_trace.reset(new search_trace_writer());
+		ok = search_trace->open(options.search_trace, result.error);
+		context.search_trace = search_trace.get();
+	}
+	ok = ok && map_circuit(*arch, context, out.get(), result.error);
+	result.telemetry.swap(context.telemetry);
+	if (search_trace) {
+		std::string error;
+		if (!search_trace->close(error) && ok) {
+			result.error = error;
+			ok = false;
+		}
+	}
+
+	if (stream) {
+		//the parser blocks on a full queue if the mapping stopped early
+		QASMparser::gate_list layer;
+		while (layer_stream.pop(layer)) {
+		}
+		producer.join();
+		context.layer_stream = NULL;
+		context.ngates = parser->getNgates();
+		if (!parse_error.empty()) {
+			result.error = parse_error;
+			ok = false;
+		}
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	if (out) {
+		out->flush();
+		if (ok && !out->good()) {
+			result.error = "cannot write the mapped circuit to " + job.output;
+			ok = false;
+		}
+	}
+	if (!ok) {
+		return result;
+	}
+
+	result.ok = true;
+	result.nqubits = context.nqubits;
+	result.ngates = context.ngates;
+	result.depth = context.layers.size();
+	result.mapped_ngates = context.mapped_ngates;
+	result.mapped_depth = context.mapped_depth;
+	result.initial_locations = context.initial_locations;
+	result.expanded_nodes = context.expanded_nodes;
+	if (cache) {
+		cache->store(key, result);
+		cache->store_source(source_key, key, context.includes);
+		emit_cached(job, options, result);
+		result.cached = false;
+	}
+	return result;
+}
+
+unsigned long estimate_job_size(const mapping_job& job) {
+	if (!job.input.empty() && is_binary_circuit(job.input)) {
+		binary_circuit_header header;
+		FILE* f = fopen(job.input.c_str(), "rb");
+		bool read = f != NULL && fread(&header, sizeof(header), 1, f) == 1;
+		if (f != NULL) {
+			fclose(f);
+		}
+		return read ? header.ngates * header.nqubits : 0;
+	}
+
+	std::string text;
+	read_input(job, text);
+	//every statement ends with ';', the qubits are declared by "qreg name[n];"
+	unsigned long statements = std::count(text.begin(), text.end(), ';');
+	unsigned long qubits = 0;
+	for (size_t pos = text.find("qreg"); pos != std::string::npos; pos = text.find("qreg", pos + 4)) {
+		size_t open = text.find('[', pos);
+		if (open != std::string::npos) {
+			qubits += strtoul(text.c_str() + open + 1, NULL, 10);
+		}
+	}
+	return statements * std::max(qubits, 1ul);
+}
+
+std::vector<mapping_result> map_batch(const std::vector<mapping_job>& jobs, const mapping_options& options,
+									  unsigned int nthreads) {
+	std::vector<unsigned long> sizes(jobs.size());
+	std::vector<size_t> order(jobs.size());
+	for (size_t i = 0; i < jobs.size(); i++) {
+		sizes[i] = estimate_job_size(jobs[i]);
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+	architecture_cache architectures;
+	std::vector<mapping_result> results(jobs.size());
+	work_stealing_pool pool(std::min<size_t>(nthreads, std::max<size_t>(jobs.size(), 1)));
+	pool.run(order, [&](size_t i) {
+		//the calling thread takes part, too, and keeps its label
+		trace_thread_name("batch worker");
+		results[i] = map_job(jobs[i], options, architectures);
+	});
+	return results;
+}
+
+bool list_batch_jobs(const std::string& path, const std::string& output_dir, std::vector<mapping_job>& jobs,
+					 std::string& error) {
+	std::vector<std::string> files;
+	DIR* dir = opendir(path.c_str());
+	if (dir != NULL) {
+		for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+			std::string name = entry->d_name;
+			if (name.size() > 5 && name.compare(name.size() - 5, 5, ".qasm") == 0) {
+				files.push_back(path + "/" + name);
+			}
+		}
+		closedir(dir);
+		std::sort(files.begin(), files.end());
+	} else {
+		std::ifstream manifest(path);
+		if (!manifest.good()) {
+			error = "cannot open " + path;
+			return false;
+		}
+		size_t slash = path.find_last_of('/');
+		std::string base = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+		std::string line;
+		while (std::getline(manifest, line)) {
+			line = line.substr(0, line.find('#'));
+			size_t begin = line.find_first_not_of(" \t\r");
+			if (begin == std::string::npos) {
+				continue;
+			}
+			line = line.substr(begin, line.find_last_not_of(" \t\r") + 1 - begin);
+			files.push_back(line[0] == '/' ? line : base + line);
+		}
+	}
+
+	for (std::vector<std::string>::iterator it = files.begin(); it != files.end(); it++) {
+		mapping_job job;
+		job.input = *it;
+		if (!output_dir.empty()) {
+			job.output = output_dir + "/" + it->substr(it->find_last_of('/') + 1);
+		}
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+//Quote a CSV field if necessary
+static std::string csv_field(const std::string& s) {
+	if (s.find_first_of(",\"\n") == std::string::npos) {
+		return s;
+	}
+	std::string quoted = "\"";
+	for (char c : s) {
+		if (c == '"') {
+			quoted += '"';
+		}
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+std::string result_json(const mapping_result& r) {
+	std::ostringstream out;
+	out << "{\"name\": " << json_escape(r.name) << ", \"ok\": " << (r.ok ? "true" : "false");
+	if (r.ok) {
+		out << ", \"nqubits\": " << r.nqubits << ", \"ngates\": " << r.ngates << ", \"depth\": " << r.depth
+			<< ", \"seconds\": " << r.seconds << ", \"mapped_ngates\": " << r.mapped_ngates
+			<< ", \"mapped_depth\": " << r.mapped_depth;
+		if (!r.qasm.empty()) {
+			out << ", \"qasm\": " << json_escape(r.qasm);
+		}
+	} else {
+		out << ", \"error\": " << json_escape(r.error);
+	}
+	out << "}";
+	return out.str();
+}
+
+bool write_results(const std::string& fname, const std::vector<mapping_result>& results, std::string& error) {
+	bool json = fname.size() > 5 && fname.compare(fname.size() - 5, 5, ".json") == 0;
+	std::ostringstream out;
+	if (json) {
+		out << "[\n";
+	} else {
+		out << "name,nqubits,ngates,depth,seconds,mapped_ngates,mapped_depth,error\n";
+	}
+	for (size_t i = 0; i < results.size(); i++) {
+		const mapping_result& r = results[i];
+		if (json) {
+			out << "  " << result_json(r) << (i + 1 < results.size() ? "," : "") << "\n";
+		} else if (r.ok) {
+			out << csv_field(r.name) << ',' << r.nqubits << ',' << r.ngates << ',' << r.depth << ',' << r.seconds << ','
+				<< r.mapped_ngates << ',' << r.mapped_depth << ",\n";
+		} else {
+			out << csv_field(r.name) << ",,,,,,," << csv_field(r.error) << "\n";
+		}
+	}
+	if (json) {
+		out << "]\n";
+	}
+
+	QASMwriter writer(fname);
+	std::string text = out.str();
+	writer.write(text.data(), text.size());
+	writer.flush();
+	if (!writer.good()) {
+		error = "cannot write " + fname;
+		return false;
+	}
+	return true;
+}
+
+bool write_telemetry(const std::string& fname, const std::vector<mapping_result>& results, std::string& error) {
+	bool csv = fname.size() > 4 && fname.compare(fname.size() - 4, 4, ".csv") == 0;
+	std::ostringstream out;
+	if (csv) {
+		out << "circuit,layer,cnots,considered_qubits,nodes_generated,nodes_expanded,duplicates_rejected,queue_replacements,"
+			   "peak_queue_size,seconds,cost_fixed,cost_heur,cost_heur2,memo_hit\n";
+	}
+	for (const mapping_result& r : results) {
+		std::string name = csv ? csv_field(r.name) : json_escape(r.name);
+		for (const layer_telemetry& t : r.telemetry) {
+			if (csv) {
+				out << name << ',' << t.layer << ',' << t.cnots << ',' << t.considered_qubits << ',' << t.nodes_generated
+					<< ',' << t.nodes_expanded << ',' << t.duplicates_rejected << ',' << t.queue_replacements << ','
+					<< t.peak_queue_size << ',' << t.seconds << ',' << t.cost_fixed << ',' << t.cost_heur << ','
+					<< t.cost_heur2 << ',' << (t.memo_hit ? 1 : 0) << "\n";
+			} else {
+				out << "{\"circuit\": " << name << ", \"layer\": " << t.layer << ", \"cnots\": " << t.cnots
+					<< ", \"considered_qubits\": " << t.considered_qubits << ", \"nodes_generated\": " << t.nodes_generated
+					<< ", \"nodes_expanded\": " << t.nodes_expanded << ", \"duplicates_rejected\": "
+					<< t.duplicates_rejected << ", \"queue_replacements\": " << t.queue_replacements << ", \"peak_queue_size\": "
+					<< t.peak_queue_size << ", \"seconds\": " << t.seconds << ", \"cost_fixed\": " << t.cost_fixed
+					<< ", \"cost_heur\": " << t.cost_heur << ", \"cost_heur2\": " << t.cost_heur2 << ", \"memo_hit\": "
+					<< (t.memo_hit ? "true" : "false") << "}\n";
+			}
+		}
+	}
+
+	QASMwriter writer(fname);
+	std::string text = out.str();
+	writer.write(text.data(), text.size());
+	writer.flush();
+	if (!writer.good()) {
+		error = "cannot write " + fname;
+		return false;
+	}
+	return true;
+}
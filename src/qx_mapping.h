@@ -0,0 +1,126 @@
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mapper.h"
+
+#ifndef QX_MAPPING_H
+#define QX_MAPPING_H
+
+#define DEFAULT_RESULT_CACHE_SIZE (1ull << 30) // bytes
+
+/*
+ * Library interface of the mapper. None of these functions terminates the process: errors are reported through
+ * the return value and an error message.
+ */
+
+struct mapping_options {
+	std::string arch = "linear"; // architecture, see build_architecture()
+	std::string dist_cache;      // directory of the distance table cache (see load_dist_table()), empty for none
+	bool stream = false;         // map while the circuit is still being parsed
+	bool keep_qasm = false;      // return the mapped circuit in mapping_result::qasm (jobs without output file)
+	unsigned long max_nodes = 0; // budget of search nodes expanded per circuit, 0 for no limit
+	double max_seconds = 0;      // budget of wall clock time per circuit, 0 for no limit
+	std::string result_cache;    // directory of the result cache (see result_cache), empty for none
+	unsigned long long result_cache_size = DEFAULT_RESULT_CACHE_SIZE;
+	bool telemetry = false;      // record statistics of the search of each layer in mapping_result::telemetry
+	std::string search_trace;    // file the search of each layer is recorded in (see search_trace.h), empty for none
+};
+
+struct mapping_job {
+	std::string input;       // QASM file or binary circuit (see write_binary_circuit()) to map
+	std::string source;      // QASM source to map if input is empty
+	std::string name;        // name reported in the result, defaults to the file name of input
+	std::string output;      // file the mapped circuit is written to ("-" for the standard output), empty for none
+	std::string save_binary; // if not empty, the parsed circuit is also saved in the binary format
+};
+
+struct mapping_result {
+	bool ok = false;
+	std::string error;                  // description of the problem if !ok
+	std::string name;
+	unsigned int nqubits = 0;
+	unsigned long ngates = 0;           // elementary gates before mapping
+	unsigned long depth = 0;            // depth (number of layers) before mapping
+	unsigned long mapped_ngates = 0;
+	int mapped_depth = 0;
+	double seconds = 0;                 // wall clock time of the mapping (including parsing when streaming)
+	std::vector<int> initial_locations; // initial physical qubit of each logical qubit (-1 if it is unused)
+	unsigned long expanded_nodes = 0;   // search nodes expanded
+	bool cached = false;                // taken from the result cache, the statistics are those of the original mapping
+	std::vector<layer_telemetry> telemetry; // if mapping_options::telemetry is set (also if the mapping failed)
+	std::string qasm;                   // mapped circuit if mapping_options::keep_qasm is set
+};
+
+/**
+ * Architectures by spec, created on first use and shared afterwards. Specs whose size depends on the circuit
+ * ("linear", "ring") are kept per number of qubits. Thread safe.
+ */
+class architecture_cache {
+public:
+	std::shared_ptr<const Architecture> get(const std::string& spec, unsigned int nqubits,
+											const std::string& dist_cache, std::string& error);
+
+private:
+	std::mutex mutex_;
+	std::map<std::string, std::shared_ptr<const Architecture> > architectures_;
+};
+
+/**
+ * Parse (or load) the circuit of the job into context.
+ */
+bool parse_circuit(const mapping_job& job, MappingContext& context, std::string& error);
+
+/**
+ * Map the circuit in context to arch. The mapped circuit is emitted to out (if not NULL) while it is determined.
+ */
+bool map_circuit(const Architecture& arch, MappingContext& context, QASMwriter* out, std::string& error);
+
+/**
+ * Parse, map and emit the circuit of a single job. If memo is not NULL, the search results of single layers are
+ * shared with other jobs using the same memo.
+ */
+mapping_result map_job(const mapping_job& job, const mapping_options& options, architecture_cache& architectures,
+					   layer_memo* memo = NULL);
+
+/**
+ * Map many circuits with the same options on nthreads threads (see work_stealing_pool). Architectures and their
+ * distance tables are built once and shared. The largest jobs according to estimate_job_size() are started first.
+ * The results are in the order of the jobs.
+ */
+std::vector<mapping_result> map_batch(const std::vector<mapping_job>& jobs, const mapping_options& options,
+									  unsigned int nthreads = 1);
+
+/**
+ * Size of a job (number of gates times number of qubits) estimated without parsing the circuit.
+ */
+unsigned long estimate_job_size(const mapping_job& job);
+
+/**
+ * Jobs for all *.qasm files in a directory (in order of their names) or for the files listed in a manifest
+ * (one file per line relative to the manifest, '#' starts a comment). If output_dir is not empty, the mapped
+ * circuits are written to files of the same name in output_dir.
+ */
+bool list_batch_jobs(const std::string& path, const std::string& output_dir, std::vector<mapping_job>& jobs,
+					 std::string& error);
+
+/**
+ * The result as JSON object: its name, statistics and mapped circuit (if kept) or its error.
+ */
+std::string result_json(const mapping_result& r);
+
+/**
+ * Write the results as JSON (if fname ends with .json) or as CSV with the columns of MINIMAL_OUTPUT followed by
+ * the error message. The file name "-" denotes the standard output.
+ */
+bool write_results(const std::string& fname, const std::vector<mapping_result>& results, std::string& error);
+
+/**
+ * Write the telemetry of the results, one record per layer, as CSV (if fname ends with .csv) or as JSON Lines.
+ * The file name "-" denotes the standard output.
+ */
+bool write_telemetry(const std::string& fname, const std::vector<mapping_result>& results, std::string& error);
+
+#endif
@@ -0,0 +1,248 @@
+#include "result_cache.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char result_magic[] = "QXMAPRES";
+static const char source_magic[] = "QXMAPSRC";
+
+//Size of the entries of a cache directory as known to this process (see evict())
+struct cache_usage {
+	bool scanned = false;
+	unsigned long long bytes = 0; // as of the last scan plus the entries stored since
+	unsigned int stores = 0; // since the last scan
+};
+
+static std::mutex usage_mutex;
+static std::map<std::string, cache_usage> usage;
+
+//Everything besides the circuit and the architecture the mapped circuits depend on
+static uint64_t configuration_key() {
+	std::string configuration = std::to_string(RESULT_CACHE_VERSION) + " " + search_configuration + " SWAP_COST="
+								+ std::to_string(SWAP_COST) + " FLIP_COST=" + std::to_string(FLIP_COST);
+	return fnv1a(configuration);
+}
+
+static bool read_file(const std::string& fname, std::string& content) {
+	std::ifstream in(fname, std::ifstream::in | std::ifstream::binary);
+	if (!in.good()) {
+		return false;
+	}
+	std::stringstream ss;
+	ss << in.rdbuf();
+	content = ss.str();
+	return true;
+}
+
+uint64_t result_cache::source_key(const std::string& input, const std::string& arch_spec) {
+	uint64_t h = fnv1a("source", 6, configuration_key());
+	//a coupling map file may change, hence its content is hashed rather than its name
+	std::string coupling_map;
+	h = fnv1a(read_file(arch_spec, coupling_map) ? coupling_map : arch_spec, h);
+	h = fnv1a("\0", 1, h);
+	return fnv1a(input, h);
+}
+
+uint64_t result_cache::circuit_key(const MappingContext& context, const Architecture& arch) {
+	uint64_t h = fnv1a("circuit", 7, configuration_key());
+	h = fnv1a(&arch.positions, sizeof(arch.positions), h);
+	for (std::set<edge>::const_iterator it = arch.graph.begin(); it != arch.graph.end(); it++) {
+		h = fnv1a(&it->v1, sizeof(it->v1), h);
+		h = fnv1a(&it->v2, sizeof(it->v2), h);
+	}
+	h = fnv1a(&context.nqubits, sizeof(context.nqubits), h);
+	for (size_t i = 0; i < context.layers.size(); i++) {
+		uint64_t size = context.layers[i].size();
+		h = fnv1a(&size, sizeof(size), h);
+		for (QASMparser::gate_list::const_iterator it = context.layers[i].begin(); it != context.layers[i].end(); it++) {
+			h = fnv1a(&it->target, sizeof(it->target), h);
+			h = fnv1a(&it->control, sizeof(it->control), h);
+			h = fnv1a(it->type, strlen(it->type) + 1, h);
+		}
+	}
+	return h;
+}
+
+std::string result_cache::path(const char* prefix, uint64_t key) const {
+	char name[64];
+	snprintf(name, sizeof(name), "/%s-%016llx", prefix, (unsigned long long) key);
+	return dir_ + name;
+}
+
+bool result_cache::find_source(uint64_t source, uint64_t& key) {
+	std::string fname = path("source", source);
+	std::string content;
+	if (!read_file(fname, content)) {
+		return false;
+	}
+	std::istringstream in(content);
+	std::string magic;
+	int version = 0;
+	in >> magic >> version >> std::hex >> key;
+	if (in.fail() || magic != source_magic || version != RESULT_CACHE_VERSION) {
+		return false;
+	}
+	//every included file is followed by the hash of its content when the entry was stored
+	uint64_t hash;
+	std::string include;
+	std::string include_content;
+	while (in >> hash && in.get() == ' ' && std::getline(in, include)) {
+		if (!read_file(include, include_content) || fnv1a(include_content) != hash) {
+			return false;
+		}
+	}
+	if (!in.eof()) {
+		return false;
+	}
+	utimensat(AT_FDCWD, fname.c_str(), NULL, 0);
+	return true;
+}
+
+bool result_cache::find(uint64_t key, mapping_result& result) {
+	std::string fname = path("result", key);
+	std::string content;
+	if (!read_file(fname, content)) {
+		return false;
+	}
+
+	std::istringstream in(content);
+	std::string magic;
+	int version = 0;
+	size_t qasm_size = 0;
+	in >> magic >> version >> result.nqubits >> result.ngates >> result.depth >> result.mapped_ngates
+	   >> result.mapped_depth >> result.seconds >> result.expanded_nodes;
+	result.initial_locations.resize(result.nqubits);
+	for (unsigned int i = 0; i < result.nqubits; i++) {
+		in >> result.initial_locations[i];
+	}
+	in >> qasm_size;
+	if (in.fail() || magic != result_magic || version != RESULT_CACHE_VERSION || in.get() != '\n') {
+		return false;
+	}
+	size_t begin = in.tellg();
+	if (content.size() - begin != qasm_size) {
+		return false;
+	}
+	result.qasm = content.substr(begin);
+	result.ok = true;
+	//the modification time is the time of the last use (see evict())
+	utimensat(AT_FDCWD, fname.c_str(), NULL, 0);
+	return true;
+}
+
+void result_cache::store(uint64_t key, const mapping_result& result) {
+	std::ostringstream out;
+	out << result_magic << ' ' << RESULT_CACHE_VERSION << '\n' << result.nqubits << ' ' << result.ngates << ' '
+		<< result.depth << ' ' << result.mapped_ngates << ' ' << result.mapped_depth << ' ' << result.seconds << ' '
+		<< result.expanded_nodes << '\n';
+	for (unsigned int i = 0; i < result.nqubits; i++) {
+		out << result.initial_locations[i] << (i + 1 < result.nqubits ? " " : "");
+	}
+	out << '\n' << result.qasm.size() << '\n' << result.qasm;
+	std::string content = out.str();
+	if (publish(path("result", key), content)) {
+		evict(content.size());
+	}
+}
+
+void result_cache::store_source(uint64_t source, uint64_t key, const std::vector<std::string>& includes) {
+	char line[64];
+	snprintf(line, sizeof(line), "%s %d %016llx\n", source_magic, RESULT_CACHE_VERSION, (unsigned long long) key);
+	std::string content = line;
+	for (size_t i = 0; i < includes.size(); i++) {
+		std::string include_content;
+		if (!read_file(includes[i], include_content)) {
+			//without its content, a change of the file could not be detected
+			return;
+		}
+		snprintf(line, sizeof(line), "%016llx ", (unsigned long long) fnv1a(include_content));
+		content += line + includes[i] + "\n";
+	}
+	if (publish(path("source", source), content)) {
+		evict(content.size());
+	}
+}
+
+bool result_cache::publish(const std::string& fname, const std::string& content) {
+	static std::atomic<unsigned long> counter(0);
+
+	//Publish atomically: concurrent readers either see no file or a complete one
+	std::string tmp = dir_ + "/.tmp-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+	FILE* f = fopen(tmp.c_str(), "wb");
+	bool written = f != NULL && fwrite(content.data(), 1, content.size(), f) == content.size();
+	if (f != NULL) {
+		written = fclose(f) == 0 && written;
+	}
+	if (!written || rename(tmp.c_str(), fname.c_str()) != 0) {
+		std::cerr << "Warning: could not write result cache " << fname << std::endl;
+		remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+//Remove the least recently used entries until the cache holds at most max_size_ bytes. The directory is only
+//scanned if the size estimate exceeds max_size_ or some stores have passed since the last scan, otherwise a batch
+//would scan the whole directory for every circuit.
+void result_cache::evict(size_t added) {
+	if (max_size_ == 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(usage_mutex);
+		cache_usage& u = usage[dir_];
+		u.bytes += added;
+		if (u.scanned && u.bytes <= max_size_ && ++u.stores < RESULT_CACHE_SCAN_INTERVAL) {
+			return;
+		}
+		u.scanned = true;
+		u.stores = 0;
+	}
+	DIR* dir = opendir(dir_.c_str());
+	if (dir == NULL) {
+		return;
+	}
+	std::vector<std::pair<struct timespec, std::pair<std::string, off_t> > > entries;
+	unsigned long long size = 0;
+	for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+		if (strncmp(entry->d_name, "result-", 7) != 0 && strncmp(entry->d_name, "source-", 7) != 0) {
+			continue;
+		}
+		std::string fname = dir_ + "/" + entry->d_name;
+		struct stat st;
+		if (stat(fname.c_str(), &st) == 0) {
+			entries.push_back(std::make_pair(st.st_mtim, std::make_pair(fname, st.st_size)));
+			size += st.st_size;
+		}
+	}
+	closedir(dir);
+
+	if (size > max_size_) {
+		std::sort(entries.begin(), entries.end(),
+				  [](const std::pair<struct timespec, std::pair<std::string, off_t> >& a,
+					 const std::pair<struct timespec, std::pair<std::string, off_t> >& b) {
+			return a.first.tv_sec != b.first.tv_sec ? a.first.tv_sec < b.first.tv_sec : a.first.tv_nsec < b.first.tv_nsec;
+		});
+		//entries removed concurrently by another process are simply skipped
+		for (size_t i = 0; i < entries.size() && size > max_size_; i++) {
+			if (unlink(entries[i].second.first.c_str()) == 0) {
+				size -= entries[i].second.second;
+			}
+		}
+	}
+	std::lock_guard<std::mutex> lock(usage_mutex);
+	usage[dir_].bytes = size;
+}
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "qx_mapping.h"
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#define RESULT_CACHE_VERSION 3 // increment whenever a change of the mapper changes the mapped circuits
+#define RESULT_CACHE_SCAN_INTERVAL 64 // stores after which the directory is scanned even if the size estimate is below max_size
+
+/**
+ * Mapped circuits and their statistics, stored in a directory and keyed by the content of what was mapped. Several
+ * processes and threads may use the same directory: entries are published atomically and are never modified.
+ * Once the entries exceed max_size bytes, the least recently used ones are removed. The size of a directory is
+ * estimated per process from the entries stored, hence the directory is only scanned once the estimate exceeds
+ * max_size or after RESULT_CACHE_SCAN_INTERVAL stores (which catches up with the entries of other processes).
+ *
+ * A result is keyed by the hash of the parsed gate stream, the coupling graph, the search configuration and
+ * RESULT_CACHE_VERSION (see circuit_key()). In addition, the hash of the raw input together with the architecture
+ * spec (see source_key()) refers to that key, hence a circuit seen before is not even parsed again. Since included
+ * files (e.g. qelib1.inc) are only known after parsing, this reference also records the hash of the content of each
+ * of them and is not used once one of them has changed.
+ */
+class result_cache {
+public:
+	result_cache(const std::string& dir, unsigned long long max_size) : dir_(dir), max_size_(max_size) {
+	}
+
+	static uint64_t source_key(const std::string& input, const std::string& arch_spec);
+	static uint64_t circuit_key(const MappingContext& context, const Architecture& arch);
+
+	/**
+	 * Look up the key of a result by the key of its input. Returns false if there is none or one of the files
+	 * included by the input has changed since.
+	 */
+	bool find_source(uint64_t source, uint64_t& key);
+
+	/**
+	 * Look up a result, i.e. everything but its name. Returns false if there is none or it cannot be read.
+	 */
+	bool find(uint64_t key, mapping_result& result);
+
+	/**
+	 * Store a result (and the input it has been determined for). Failing to do so only results in a warning.
+	 */
+	void store(uint64_t key, const mapping_result& result);
+	void store_source(uint64_t source, uint64_t key, const std::vector<std::string>& includes);
+
+private:
+	std::string dir_;
+	unsigned long long max_size_;
+
+	std::string path(const char* prefix, uint64_t key) const;
+	bool publish(const std::string& fname, const std::string& content);
+	void evict(size_t added);
+};
+
+#endif
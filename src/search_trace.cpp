@@ -0,0 +1,143 @@
+#include "search_trace.h"
+
+static const char search_trace_magic[8] = {'Q', 'X', 'S', 'T', 'R', 'A', 'C', 'E'};
+
+bool search_trace_writer::open(const std::string& fname, std::string& error) {
+	file_ = fopen(fname.c_str(), "wb");
+	if (file_ == NULL) {
+		error = "cannot open " + fname;
+		return false;
+	}
+	//records are buffered in buffer_ only
+	setvbuf(file_, NULL, _IONBF, 0);
+	fname_ = fname;
+	used_ = 0;
+	failed_ = false;
+	memcpy(buffer_, search_trace_magic, sizeof(search_trace_magic));
+	used_ = sizeof(search_trace_magic);
+	put<uint32_t>(SEARCH_TRACE_VERSION);
+	return true;
+}
+
+bool search_trace_writer::close(std::string& error) {
+	if (file_ == NULL) {
+		return true;
+	}
+	flush();
+	failed_ = fclose(file_) != 0 || failed_;
+	file_ = NULL;
+	if (failed_) {
+		error = "cannot write " + fname_;
+		return false;
+	}
+	return true;
+}
+
+void search_trace_writer::flush() {
+	if (used_ > 0 && !failed_ && fwrite(buffer_, 1, used_, file_) != used_) {
+		failed_ = true;
+	}
+	used_ = 0;
+}
+
+void search_trace_writer::layer(unsigned int layer, int positions) {
+	put<char>('L');
+	put<uint32_t>(layer);
+	put<uint32_t>(positions);
+}
+
+void search_trace_writer::node(unsigned int id, unsigned int parent, int cost_fixed, int cost_heur, int cost_heur2,
+							   bool done, bool inserted, uint64_t state, const edge* swaps, int nswaps) {
+	put<char>('N');
+	put<uint32_t>(id);
+	put<uint32_t>(parent);
+	put<int32_t>(cost_fixed);
+	put<int32_t>(cost_heur);
+	put<int32_t>(cost_heur2);
+	put<uint8_t>((done ? 1 : 0) | (inserted ? 2 : 0));
+	put<uint64_t>(state);
+	put<uint16_t>(nswaps);
+	for (int i = 0; i < nswaps; i++) {
+		put<uint16_t>(swaps[i].v1);
+		put<uint16_t>(swaps[i].v2);
+	}
+}
+
+void search_trace_writer::expanded(unsigned int id) {
+	put<char>('E');
+	put<uint32_t>(id);
+}
+
+void search_trace_writer::goal(unsigned int id) {
+	put<char>('G');
+	put<uint32_t>(id);
+}
+
+bool search_trace_reader::open(const std::string& fname, std::string& error) {
+	file_ = fopen(fname.c_str(), "rb");
+	if (file_ == NULL) {
+		error = "cannot open " + fname;
+		return false;
+	}
+	char magic[sizeof(search_trace_magic)];
+	uint32_t version = 0;
+	if (fread(magic, sizeof(magic), 1, file_) != 1 || memcmp(magic, search_trace_magic, sizeof(magic)) != 0
+		|| !get(version)) {
+		error = fname + " is not a search trace";
+		return false;
+	}
+	if (version != SEARCH_TRACE_VERSION) {
+		error = fname + " has version " + std::to_string(version) + " instead of "
+				+ std::to_string(SEARCH_TRACE_VERSION);
+		return false;
+	}
+	return true;
+}
+
+bool search_trace_reader::next(search_trace_record& record, std::string& error) {
+	char kind;
+	if (!get(kind)) {
+		return false;
+	}
+	record.kind = kind;
+	record.layer = layer_;
+	bool ok = true;
+	uint32_t u32 = 0;
+	if (kind == 'L') {
+		ok = get(u32);
+		layer_ = record.layer = u32;
+		ok = ok && get(u32);
+		record.positions = u32;
+	} else if (kind == 'N') {
+		uint32_t parent = 0;
+		int32_t costs[3] = {0, 0, 0};
+		uint8_t flags = 0;
+		uint16_t nswaps = 0;
+		ok = get(u32) && get(parent) && get(costs[0]) && get(costs[1]) && get(costs[2]) && get(flags)
+			 && get(record.state) && get(nswaps);
+		record.id = u32;
+		record.parent = parent;
+		record.cost_fixed = costs[0];
+		record.cost_heur = costs[1];
+		record.cost_heur2 = costs[2];
+		record.done = (flags & 1) != 0;
+		record.inserted = (flags & 2) != 0;
+		record.swaps.resize(nswaps);
+		for (uint16_t i = 0; ok && i < nswaps; i++) {
+			uint16_t v1 = 0;
+			uint16_t v2 = 0;
+			ok = get(v1) && get(v2);
+			record.swaps[i] = edge{v1, v2};
+		}
+	} else if (kind == 'E' || kind == 'G') {
+		ok = get(u32);
+		record.id = u32;
+	} else {
+		error = std::string("unknown record '") + kind + "'";
+		return false;
+	}
+	if (!ok) {
+		error = "truncated trace";
+	}
+	return ok;
+}
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "architecture.h"
+
+#ifndef SEARCH_TRACE_H
+#define SEARCH_TRACE_H
+
+#define SEARCH_TRACE_VERSION 1
+#define SEARCH_TRACE_BUFFER_SIZE (1 << 16) // bytes buffered before they are written
+#define SEARCH_TRACE_NO_PARENT 0xffffffffu
+
+/*
+ * Binary trace of the A* search of all layers of a circuit, written in the native byte order:
+ *
+ *   header  "QXSTRACE" u32 version
+ *   'L'     search of a layer begins: u32 layer, u32 positions (node ids start at 0 in every layer)
+ *   'N'     node generated: u32 id, u32 parent id (SEARCH_TRACE_NO_PARENT for the root), i32 cost_fixed (g),
+ *           i32 cost_heur (h), i32 cost_heur2 (h2), u8 flags (1: done, 2: inserted into the queue, i.e. not dropped
+ *           as a duplicate), u64 hash of the permutation, u16 number of SWAPs applied to the parent, u16 pairs of the
+ *           locations swapped
+ *   'E'     node expanded: u32 id
+ *   'G'     node found: u32 id (missing if the search has been aborted)
+ */
+
+struct search_trace_record {
+	char kind; // 'L', 'N', 'E' or 'G'
+	unsigned int layer;
+	unsigned int positions;
+	unsigned int id;
+	unsigned int parent;
+	int cost_fixed;
+	int cost_heur;
+	int cost_heur2;
+	bool done;
+	bool inserted;
+	uint64_t state;
+	std::vector<edge> swaps;
+};
+
+/**
+ * Streams the trace to a file through a buffer of SEARCH_TRACE_BUFFER_SIZE bytes, i.e. tracing does not grow the
+ * memory of the mapping. Not thread safe: each search traced needs a writer of its own.
+ */
+class search_trace_writer {
+public:
+	search_trace_writer() : file_(NULL), used_(0), failed_(false) {
+	}
+
+	~search_trace_writer() {
+		std::string error;
+		close(error);
+	}
+
+	search_trace_writer(const search_trace_writer&) = delete;
+	search_trace_writer& operator=(const search_trace_writer&) = delete;
+
+	bool open(const std::string& fname, std::string& error);
+	// flush the buffer and close the file; false if anything could not be written
+	bool close(std::string& error);
+
+	void layer(unsigned int layer, int positions);
+	void node(unsigned int id, unsigned int parent, int cost_fixed, int cost_heur, int cost_heur2, bool done,
+			  bool inserted, uint64_t state, const edge* swaps, int nswaps);
+	void expanded(unsigned int id);
+	void goal(unsigned int id);
+
+private:
+	FILE* file_;
+	std::string fname_;
+	char buffer_[SEARCH_TRACE_BUFFER_SIZE];
+	size_t used_;
+	bool failed_;
+
+	template<class T>
+	void put(T value) {
+		if (used_ + sizeof(value) > sizeof(buffer_)) {
+			flush();
+		}
+		memcpy(buffer_ + used_, &value, sizeof(value));
+		used_ += sizeof(value);
+	}
+
+	void flush();
+};
+
+/**
+ * Reads a trace written by search_trace_writer record by record.
+ */
+class search_trace_reader {
+public:
+	search_trace_reader() : file_(NULL) {
+	}
+
+	~search_trace_reader() {
+		if (file_ != NULL) {
+			fclose(file_);
+		}
+	}
+
+	search_trace_reader(const search_trace_reader&) = delete;
+	search_trace_reader& operator=(const search_trace_reader&) = delete;
+
+	bool open(const std::string& fname, std::string& error);
+	// false at the end of the trace or if it is truncated (see error)
+	bool next(search_trace_record& record, std::string& error);
+
+private:
+	FILE* file_;
+	unsigned int layer_ = 0;
+
+	template<class T>
+	bool get(T& value) {
+		return fread(&value, sizeof(value), 1, file_) == 1;
+	}
+};
+
+#endif
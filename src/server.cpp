@@ -0,0 +1,335 @@
+#include "server.h"
+#include "bounded_queue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_HEADER_LENGTH 4096
+#define READ_BUFFER_SIZE 65536
+
+//A client connection, closed once neither its reader nor a pending request refers to it
+struct connection {
+	int fd;
+	std::mutex write_mutex; // responses are sent by the worker threads
+
+	explicit connection(int fd) : fd(fd) {
+	}
+
+	~connection() {
+		close(fd);
+	}
+
+	bool send_all(const std::string& data) {
+		std::lock_guard<std::mutex> lock(write_mutex);
+		for (size_t sent = 0; sent < data.size();) {
+			ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return false;
+			}
+			sent += n;
+		}
+		return true;
+	}
+};
+
+//Bytes of the requests read but not yet answered
+class byte_budget {
+public:
+	explicit byte_budget(size_t capacity) : capacity(capacity) {
+	}
+
+	//Blocks until n bytes are available. A request larger than the capacity is admitted once nothing else is pending.
+	void acquire(size_t n) {
+		std::unique_lock<std::mutex> lock(mutex);
+		available.wait(lock, [this, n]() { return used == 0 || used + n <= capacity; });
+		used += n;
+	}
+
+	void release(size_t n) {
+		std::lock_guard<std::mutex> lock(mutex);
+		used -= n;
+		available.notify_all();
+	}
+
+private:
+	size_t capacity;
+	size_t used = 0;
+	std::mutex mutex;
+	std::condition_variable available;
+};
+
+struct request {
+	std::shared_ptr<connection> conn;
+	std::string id;
+	mapping_job job;
+	mapping_options options;
+	byte_budget* budget = NULL; // the size of the source is returned to budget once the request is answered
+	size_t reserved = 0;
+
+	~request() {
+		if (budget != NULL) {
+			budget->release(reserved);
+		}
+	}
+};
+
+//State shared by the acceptor, the readers of the connections and the workers
+struct server_state {
+	mapping_options defaults;
+	size_t max_request_size;
+	architecture_cache architectures;
+	layer_memo memo;
+	byte_budget pending_bytes; // declared before requests, which return their bytes when destroyed
+	bounded_queue<std::unique_ptr<request> > requests;
+
+	//connections whose reader is running
+	unsigned int max_connections;
+	unsigned int connections = 0;
+	std::mutex connections_mutex;
+	std::condition_variable connection_closed;
+
+	server_state(const server_options& server, const mapping_options& defaults)
+		: defaults(defaults), max_request_size(server.max_request_size), memo(server.memo_capacity),
+		  pending_bytes(server.max_pending_bytes), requests(server.queue_capacity),
+		  max_connections(std::max(server.max_connections, 1u)) {
+		this->defaults.keep_qasm = true;
+	}
+};
+
+//Buffered reading of the requests of a connection
+class socket_reader {
+public:
+	explicit socket_reader(int fd) : fd(fd) {
+	}
+
+	//Read a line without its '\n'. Returns false at the end of the input or if the line is longer than max_length.
+	bool read_line(std::string& line, size_t max_length) {
+		line.clear();
+		for (;;) {
+			char* newline = (char*) memchr(buffer + begin, '\n', end - begin);
+			size_t n = newline != NULL ? newline - (buffer + begin) : end - begin;
+			line.append(buffer + begin, n);
+			if (line.size() > max_length) {
+				return false;
+			}
+			if (newline != NULL) {
+				begin += n + 1;
+				return true;
+			}
+			begin = end;
+			if (!fill()) {
+				return false;
+			}
+		}
+	}
+
+	//Read n bytes. The caller bounds n, the string grows with the data actually received.
+	bool read(std::string& data, size_t n) {
+		data.clear();
+		while (data.size() < n) {
+			if (begin == end && !fill()) {
+				return false;
+			}
+			size_t m = std::min(n - data.size(), end - begin);
+			data.append(buffer + begin, m);
+			begin += m;
+		}
+		return true;
+	}
+
+private:
+	int fd;
+	char buffer[READ_BUFFER_SIZE];
+	size_t begin = 0;
+	size_t end = 0;
+
+	bool fill() {
+		ssize_t n;
+		do {
+			n = recv(fd, buffer, sizeof(buffer), 0);
+		} while (n < 0 && errno == EINTR);
+		begin = 0;
+		end = n > 0 ? n : 0;
+		return n > 0;
+	}
+};
+
+static std::string response(const std::string& id, const mapping_result& result) {
+	std::string json = result_json(result);
+	return id + " " + std::to_string(json.size()) + "\n" + json;
+}
+
+//Apply an option of a request, returns false if it is unknown or its value is invalid
+static bool parse_option(const std::string& option, request& r) {
+	size_t eq = option.find('=');
+	if (eq == std::string::npos) {
+		return false;
+	}
+	std::string key = option.substr(0, eq);
+	std::string value = option.substr(eq + 1);
+	char* end;
+	if (key == "arch") {
+		r.options.arch = value;
+		return !value.empty();
+	} else if (key == "name") {
+		r.job.name = value;
+		return true;
+	} else if (key == "max_nodes") {
+		r.options.max_nodes = strtoul(value.c_str(), &end, 10);
+	} else if (key == "max_seconds") {
+		r.options.max_seconds = strtod(value.c_str(), &end);
+	} else {
+		return false;
+	}
+	return !value.empty() && *end == '\0';
+}
+
+//Read the requests of a connection and queue them for the workers. Blocks while the queue is full or the sources
+//of the pending requests exceed their budget.
+static void read_connection(const std::shared_ptr<connection>& conn, server_state& state) {
+	std::unique_ptr<socket_reader> reader(new socket_reader(conn->fd));
+	std::string line;
+	while (reader->read_line(line, MAX_HEADER_LENGTH)) {
+		if (line.empty() || line == "\r") {
+			continue;
+		}
+		std::unique_ptr<request> r(new request());
+		r->conn = conn;
+		r->options = state.defaults;
+
+		std::istringstream header(line);
+		std::string command;
+		long long nbytes = -1;
+		header >> command >> r->id >> nbytes;
+		if (command != "MAP" || r->id.empty() || nbytes < 0) {
+			conn->send_all("ERROR expected MAP <id> <nbytes> [options]\n");
+			return;
+		}
+		if ((unsigned long long) nbytes > state.max_request_size) {
+			conn->send_all("ERROR request too large\n");
+			return;
+		}
+		state.pending_bytes.acquire(nbytes);
+		r->budget = &state.pending_bytes;
+		r->reserved = nbytes;
+		if (!reader->read(r->job.source, nbytes)) {
+			return;
+		}
+
+		std::string option;
+		std::string invalid;
+		while (invalid.empty() && header >> option) {
+			if (!parse_option(option, *r)) {
+				invalid = option;
+			}
+		}
+		if (!invalid.empty()) {
+			mapping_result result;
+			result.name = r->job.name;
+			result.error = "invalid option " + invalid;
+			conn->send_all(response(r->id, result));
+			continue;
+		}
+		state.requests.push(std::move(r));
+	}
+}
+
+//An exception (e.g. std::bad_alloc) only ends its connection, not the server
+static void read_requests(std::shared_ptr<connection> conn, std::shared_ptr<server_state> state) {
+	try {
+		read_connection(conn, *state);
+	} catch (const std::exception& e) {
+		conn->send_all(std::string("ERROR ") + e.what() + "\n");
+	}
+	std::lock_guard<std::mutex> lock(state->connections_mutex);
+	state->connections--;
+	state->connection_closed.notify_one();
+}
+
+static void work(std::shared_ptr<server_state> state) {
+	std::unique_ptr<request> r;
+	while (state->requests.pop(r)) {
+		mapping_result result;
+		try {
+			result = map_job(r->job, r->options, state->architectures, &state->memo);
+		} catch (const std::exception& e) {
+			result = mapping_result();
+			result.name = r->job.name;
+			result.error = e.what();
+		}
+		r->conn->send_all(response(r->id, result));
+		r.reset();
+	}
+}
+
+bool serve(const server_options& server, const mapping_options& defaults, std::string& error) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (server.socket.empty() || server.socket.size() >= sizeof(address.sun_path)) {
+		error = "invalid socket path " + server.socket;
+		return false;
+	}
+	strcpy(address.sun_path, server.socket.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		error = std::string("cannot create socket: ") + strerror(errno);
+		return false;
+	}
+	//a socket left behind by a previous server would make bind() fail
+	unlink(server.socket.c_str());
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		error = "cannot listen on " + server.socket + ": " + strerror(errno);
+		close(fd);
+		return false;
+	}
+
+	std::shared_ptr<server_state> state = std::make_shared<server_state>(server, defaults);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::max(server.nthreads, 1u); i++) {
+		workers.push_back(std::thread(work, state));
+	}
+
+	for (;;) {
+		//further clients wait in the backlog of the socket
+		{
+			std::unique_lock<std::mutex> lock(state->connections_mutex);
+			state->connection_closed.wait(lock, [&state]() { return state->connections < state->max_connections; });
+		}
+		int client = accept(fd, NULL, NULL);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			error = std::string("cannot accept connections: ") + strerror(errno);
+			break;
+		}
+		{
+			std::lock_guard<std::mutex> lock(state->connections_mutex);
+			state->connections++;
+		}
+		std::thread(read_requests, std::make_shared<connection>(client), state).detach();
+	}
+
+	close(fd);
+	unlink(server.socket.c_str());
+	state->requests.close();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	return false;
+}
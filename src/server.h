@@ -0,0 +1,47 @@
+#include <string>
+
+#include "qx_mapping.h"
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#define DEFAULT_QUEUE_CAPACITY 64     // requests read but not yet mapped, see server_options
+#define DEFAULT_MEMO_CAPACITY 65536   // layers kept in the layer_memo of the server
+#define DEFAULT_MAX_REQUEST_SIZE (64 << 20) // bytes of QASM source of a request
+#define DEFAULT_MAX_CONNECTIONS 256          // connections served at a time, see server_options
+#define DEFAULT_MAX_PENDING_BYTES (256 << 20) // bytes of QASM source of all requests read but not yet answered
+
+struct server_options {
+	std::string socket;                             // path of the Unix domain socket
+	unsigned int nthreads = 1;                      // number of requests mapped concurrently
+	size_t queue_capacity = DEFAULT_QUEUE_CAPACITY; // once that many requests wait, no further requests are read
+	size_t memo_capacity = DEFAULT_MEMO_CAPACITY;
+	size_t max_request_size = DEFAULT_MAX_REQUEST_SIZE; // larger requests are refused and their connection closed
+	unsigned int max_connections = DEFAULT_MAX_CONNECTIONS; // further clients wait until a connection is closed
+	size_t max_pending_bytes = DEFAULT_MAX_PENDING_BYTES; // once reached, requests are only read as others are answered
+};
+
+/**
+ * Serve mapping requests on a Unix domain socket. Architectures, distance tables, included gate libraries
+ * (qelib1.inc) and the search results of single layers are kept for all requests, hence a request only costs its
+ * actual mapping. A client may send any number of requests over a connection without waiting for the responses.
+ * Each request is
+ *
+ *   MAP <id> <nbytes> [arch=<architecture>] [name=<name>] [max_nodes=<n>] [max_seconds=<s>]\n
+ *   <nbytes bytes of QASM source>
+ *
+ * where options not given are taken from defaults. The response to a request is sent as soon as its circuit is
+ * mapped (i.e. not necessarily in the order of the requests):
+ *
+ *   <id> <nbytes>\n
+ *   <nbytes bytes of a JSON object with the statistics, the mapped circuit ("qasm") or the error>
+ *
+ * A malformed request or one of more than server.max_request_size bytes is answered by "ERROR <message>\n" and the
+ * connection is closed. Each connection has a reader thread; at most server.max_connections are served at a time
+ * and the sources of the requests read but not yet answered are limited to server.max_pending_bytes (a single
+ * larger request is read once no other one is pending), which bounds the memory of the server. Only returns (false) if
+ * the socket cannot be set up or accepting connections fails; the problem is described in error.
+ */
+bool serve(const server_options& server, const mapping_options& defaults, std::string& error);
+
+#endif
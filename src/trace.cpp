@@ -0,0 +1,116 @@
+#include "trace.h"
+#include "QASMwriter.h"
+#include "json.h"
+
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+std::atomic<bool> trace_enabled(false);
+
+struct trace_event {
+	const char* name;
+	std::chrono::steady_clock::time_point begin;
+	std::chrono::steady_clock::time_point end;
+	std::string args;
+};
+
+//Events of one thread. The buffer outlives the thread, hence events of finished threads are written, too.
+struct thread_trace {
+	int tid;
+	const char* name = NULL; // role of the thread (see trace_thread_name())
+	std::mutex mutex; // only contended while the trace is written
+	std::vector<trace_event> events;
+};
+
+static std::mutex threads_mutex;
+static std::vector<std::shared_ptr<thread_trace> > threads;
+static std::chrono::steady_clock::time_point origin;
+
+static thread_trace& this_thread_trace() {
+	thread_local std::shared_ptr<thread_trace> trace;
+	if (!trace) {
+		trace = std::make_shared<thread_trace>();
+		std::lock_guard<std::mutex> lock(threads_mutex);
+		trace->tid = threads.size() + 1;
+		threads.push_back(trace);
+	}
+	return *trace;
+}
+
+void trace_start() {
+	origin = std::chrono::steady_clock::now();
+	trace_enabled = true;
+	trace_thread_name("main");
+}
+
+void trace_thread_name(const char* name) {
+	if (!trace_enabled.load(std::memory_order_relaxed)) {
+		return;
+	}
+	thread_trace& trace = this_thread_trace();
+	std::lock_guard<std::mutex> lock(trace.mutex);
+	if (trace.name == NULL) {
+		trace.name = name;
+	}
+}
+
+trace_scope::trace_scope(const char* name, const char* arg_name, const std::string& arg) : trace_scope(name) {
+	if (name_ != NULL) {
+		args_ = "{\"" + std::string(arg_name) + "\": " + json_escape(arg) + "}";
+	}
+}
+
+void trace_scope::record() {
+	thread_trace& trace = this_thread_trace();
+	std::lock_guard<std::mutex> lock(trace.mutex);
+	trace.events.push_back(trace_event{name_, begin_, std::chrono::steady_clock::now(), std::move(args_)});
+}
+
+static double microseconds(std::chrono::steady_clock::duration d) {
+	return std::chrono::duration<double, std::micro>(d).count();
+}
+
+bool trace_write(const std::string& fname, std::string& error) {
+	std::ostringstream out;
+	out.precision(3);
+	out << std::fixed << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	int pid = getpid();
+	bool first = true;
+	//the lock is released before the file is written, since writing records an event (possibly of a new thread)
+	std::unique_lock<std::mutex> threads_lock(threads_mutex);
+	for (const std::shared_ptr<thread_trace>& trace : threads) {
+		std::lock_guard<std::mutex> lock(trace->mutex);
+		std::string name = trace->name != NULL ? trace->name : "thread";
+		if (name != "main") {
+			name += " " + std::to_string(trace->tid);
+		}
+		out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": "
+			<< trace->tid << ", \"args\": {\"name\": \"" << name << "\"}}";
+		first = false;
+		for (const trace_event& e : trace->events) {
+			out << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"qx_mapping\", \"ph\": \"X\", \"ts\": "
+				<< microseconds(e.begin - origin) << ", \"dur\": " << microseconds(e.end - e.begin) << ", \"pid\": "
+				<< pid << ", \"tid\": " << trace->tid;
+			if (!e.args.empty()) {
+				out << ", \"args\": " << e.args;
+			}
+			out << "}";
+		}
+	}
+	threads_lock.unlock();
+	out << "\n]}\n";
+
+	QASMwriter writer(fname);
+	std::string text = out.str();
+	writer.write(text.data(), text.size());
+	writer.flush();
+	if (!writer.good()) {
+		error = "cannot write " + fname;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,73 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Timeline of the phases of the mapping in the Chrome trace event format (JSON), to be opened with about:tracing
+ * or Perfetto. Tracing is off unless trace_start() has been called; a disabled trace_scope only tests a flag.
+ */
+extern std::atomic<bool> trace_enabled;
+
+/**
+ * Start recording the trace_scopes of all threads. The calling thread is labelled "main".
+ */
+void trace_start();
+
+/**
+ * Label the current thread by its role (e.g. "parser") in the trace, unless it has been labelled already. Threads
+ * without a label are shown as "thread". The tid is appended to all labels but "main".
+ */
+void trace_thread_name(const char* name);
+
+/**
+ * Write all events recorded so far. The file name "-" denotes the standard output.
+ */
+bool trace_write(const std::string& fname, std::string& error);
+
+/**
+ * Records the time between its construction and destruction as an event of the current thread. The name must be
+ * a string literal. Optionally, an argument shown with the event can be given (e.g. the layer of a search).
+ */
+class trace_scope {
+public:
+	explicit trace_scope(const char* name) : name_(NULL) {
+		if (trace_enabled.load(std::memory_order_relaxed)) {
+			name_ = name;
+			begin_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	trace_scope(const char* name, const char* arg_name, long arg) : trace_scope(name) {
+		if (name_ != NULL) {
+			args_ = "{\"" + std::string(arg_name) + "\": " + std::to_string(arg) + "}";
+		}
+	}
+
+	trace_scope(const char* name, const char* arg_name, const std::string& arg);
+
+	~trace_scope() {
+		if (name_ != NULL) {
+			record();
+		}
+	}
+
+	trace_scope(const trace_scope&) = delete;
+	trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+	const char* name_;
+	std::chrono::steady_clock::time_point begin_;
+	std::string args_; // JSON object
+
+	void record();
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// trace the remainder of the enclosing block, e.g. TRACE_SCOPE("parse") or TRACE_SCOPE("search", "layer", i)
+#define TRACE_SCOPE(...) trace_scope TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
+
+#endif
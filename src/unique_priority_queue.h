@@ -2,6 +2,8 @@
 #include <queue>
 #include <assert.h>
 
+#include "profile.h"
+
 #ifndef UNIQUE_PRIORITY_QUEUE_H
 #define UNIQUE_PRIORITY_QUEUE_H
 
@@ -15,12 +17,20 @@ struct do_nothing {
 /**
  * Priority queue with unique (according to FuncCompare) elements of type T where the sorting is based on CostCompare.
  * If NDEBUG is *not* defined, there are some assertions that help catching errors in the provided comparision functions.
+ * The heap and the membership set allocate with QueueAllocator and SetAllocator, respectively. Membership may be
+ * replaced by a hash set (e.g. std::unordered_set) whose equality agrees with FuncCompare.
+ * With LazyReplacement, an element replaced by one of lower cost stays in the heap (instead of rebuilding the heap)
+ * and is dropped when it reaches the top. It is only recognised as replaced while no equivalent element of the same
+ * cost is queued, hence the caller must not rely on the order of equivalent elements pushed again after a pop.
  */
-template<class T, class CleanObsoleteElement = do_nothing<T>, class CostCompare = std::less<T>, class FuncCompare = CostCompare>
+template<class T, class CleanObsoleteElement = do_nothing<T>, class CostCompare = std::less<T>, class FuncCompare = CostCompare,
+         class QueueAllocator = std::allocator<T>, class SetAllocator = QueueAllocator,
+         class Membership = std::set<T, FuncCompare, SetAllocator>, bool LazyReplacement = false>
 class unique_priority_queue
 {
 public:
-    typedef typename std::priority_queue<T, std::vector<T>, CostCompare>::size_type size_type;
+    typedef std::priority_queue<T, std::vector<T, QueueAllocator>, CostCompare> queue_type;
+    typedef typename queue_type::size_type size_type;
 
     /**
      * Return true if the element was inserted into the queue.
@@ -29,6 +39,7 @@ public:
      */
     bool push(const T& v)
     {
+        PROFILE_TIMER(queue_push);
         const auto& insertion_pair = membership_.insert(v);
         if(insertion_pair.second)
         {
@@ -41,7 +52,13 @@ public:
             CleanObsoleteElement()(*(insertion_pair.first));
             const auto inserted = membership_.insert(v);
             assert(inserted.second);
-            queue_ = std::priority_queue<T, std::vector<T>, CostCompare>();
+            replacements_++;
+            if(LazyReplacement)
+            {
+                queue_.push(v);
+                return true;
+            }
+            queue_ = queue_type();
             for(const auto& element : membership_) {
                 queue_.push(element);
             }
@@ -49,13 +66,14 @@ public:
             return true;
 
         }
-        assert(queue_.size() == membership_.size());
+        assert(queue_.size() >= membership_.size());
         return insertion_pair.second;
     }
 
     void pop()
     {
-        assert(!queue_.empty() && queue_.size() == membership_.size());
+        PROFILE_TIMER(queue_pop);
+        assert(!queue_.empty() && queue_.size() >= membership_.size());
 
         const auto& top_element = queue_.top();
         const auto number_erased = membership_.erase(top_element);
@@ -63,7 +81,11 @@ public:
         assert(number_erased == 1);
 
         queue_.pop();
-        assert(queue_.size() == membership_.size());
+        if(LazyReplacement)
+        {
+            drop_replaced();
+        }
+        assert(queue_.size() >= membership_.size());
     }
 
     const T& top() const
@@ -74,17 +96,41 @@ public:
 
     bool empty() const
     {
-        assert(queue_.size() == membership_.size());
-        return queue_.empty();
+        assert(queue_.empty() == membership_.empty());
+        return membership_.empty();
     }
 
     size_type size() const
     {
-        return queue_.size();
+        return membership_.size();
+    }
+
+    /**
+     * Number of times an element has been replaced by an equivalent one of lower cost.
+     */
+    size_type replacements() const
+    {
+        return replacements_;
     }
 
 private:
-    std::priority_queue<T, std::vector<T>, CostCompare> queue_;
-    std::set<T, FuncCompare> membership_;
+    queue_type queue_;
+    Membership membership_;
+    size_type replacements_ = 0;
+
+    // Pop replaced elements off the top, i.e. those without equivalent in membership_ or with a cheaper one there.
+    // Replacing the top itself pushes a cheaper element, hence the top is always current after push().
+    void drop_replaced()
+    {
+        while(!queue_.empty())
+        {
+            const auto it = membership_.find(queue_.top());
+            if(it != membership_.end() && !CostCompare()(queue_.top(), *it))
+            {
+                break;
+            }
+            queue_.pop();
+        }
+    }
 };
 #endif
@@ -0,0 +1,74 @@
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+/**
+ * Runs task(item) for a list of items on a fixed number of threads. The items are dealt round robin to one deque
+ * per thread in the given order. A thread works through its own deque from the front; once it is empty, it steals
+ * from the front of the other deques. Hence, items given first (e.g. the longest jobs) are started first overall,
+ * and no thread idles while work is left.
+ */
+class work_stealing_pool
+{
+public:
+    explicit work_stealing_pool(unsigned int nthreads) : queues_(nthreads > 0 ? nthreads : 1) {
+    }
+
+    void run(const std::vector<size_t>& items, const std::function<void(size_t)>& task)
+    {
+        for(size_t i = 0; i < items.size(); i++) {
+            queues_[i % queues_.size()].items.push_back(items[i]);
+        }
+
+        std::vector<std::thread> threads;
+        for(size_t t = 1; t < queues_.size(); t++) {
+            threads.push_back(std::thread([this, t, &task]() { work(t, task); }));
+        }
+        work(0, task);
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    std::vector<queue> queues_;
+
+    bool take(size_t q, size_t& item)
+    {
+        std::lock_guard<std::mutex> lock(queues_[q].mutex);
+        if(queues_[q].items.empty()) {
+            return false;
+        }
+        item = queues_[q].items.front();
+        queues_[q].items.pop_front();
+        return true;
+    }
+
+    void work(size_t self, const std::function<void(size_t)>& task)
+    {
+        size_t item;
+        for(;;) {
+            bool found = take(self, item);
+            for(size_t i = 1; !found && i < queues_.size(); i++) {
+                found = take((self + i) % queues_.size(), item);
+            }
+            if(!found) {
+                //items are only added before the threads start, hence all work has been taken
+                return;
+            }
+            task(item);
+        }
+    }
+};
+
+#endif